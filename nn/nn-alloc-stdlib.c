@@ -10,6 +10,8 @@
 */
 
 #include "nn.h"
+#include "nn-fixed.h"
+#include "nn-quant.h"
 #include "nn-alloc.h"
 
 #if defined(STATICALLOC)
@@ -19,9 +21,20 @@
 #else
 #	include <stdlib.h>
 #endif
+#include <stdint.h>
+#include <string.h>
 
 // reset nn to empty, returning 1 for success or 0 for failure
 int NNReset(NN *nn, int maxLayerCount) {
+	if (nn->arena) {
+		// layers and their data are all in the arena
+		free(nn->arena);
+		nn->arena = NULL;
+		nn->arenaSize = 0;
+		nn->layer = 0;
+		nn->layerCount = 0;
+	}
+
 	// dealloc all layers
 	for (int k = 0; k < nn->layerCount; k++) {
 		if (nn->layer[k].data) {
@@ -50,6 +63,72 @@ int NNReset(NN *nn, int maxLayerCount) {
 	return 1;
 }
 
+// first address aligned on NNArenaAlignment at or after p
+static void *arenaAlign(void *p) {
+	return (void *)(((uintptr_t)p + NNArenaAlignment - 1)
+		& ~(uintptr_t)(NNArenaAlignment - 1));
+}
+
+// reset nn to a single block of memory for all layers
+int NNResetArena(NN *nn, int layerCount, int const *size) {
+	if (!NNReset(nn, 0) || layerCount <= 0) {
+		return 0;
+	}
+
+	int arenaSize = NNArenaSize(layerCount, size);
+	nn->arena = malloc(arenaSize);
+	if (!nn->arena) {
+		return 0;
+	}
+	nn->arenaSize = arenaSize;
+	nn->layer = (NNLayer *)arenaAlign(nn->arena);
+	nn->maxLayerCount = layerCount;
+
+	return 1;
+}
+
+// add a layer to the arena after the previous one
+static int addLayerToArena(NN *nn, NNLayer *layer,
+	int inputCount, int outputCount) {
+	NNFloat *data;
+	if (nn->layerCount == 0) {
+		data = (NNFloat *)arenaAlign(nn->layer + nn->maxLayerCount);
+		layer->input = data;
+		data += NNArenaRound(inputCount);
+	} else {
+		NNLayer const *layerPrev = &nn->layer[nn->layerCount - 1];
+		data = layerPrev->output + NNArenaRound(layerPrev->outputCount);
+		layer->input = NULL;
+	}
+	layer->W = data;
+	data += NNArenaRound(inputCount * outputCount);
+	layer->B = data;
+	data += NNArenaRound(outputCount);
+	layer->output = data;
+	data += NNArenaRound(outputCount);
+
+	if ((char *)data > (char *)nn->arena + nn->arenaSize) {
+		return 0;
+	}
+	layer->data = NULL;
+	return 1;
+}
+
+// set sizes and activation of layer being added and update nn
+static void addLayerInfo(NN *nn,
+	int inputCount, int outputCount, NNActivation activation) {
+	nn->layer[nn->layerCount].inputCount = inputCount;
+	nn->layer[nn->layerCount].outputCount = outputCount;
+	nn->layer[nn->layerCount].activation = activation;
+	nn->layer[nn->layerCount].kernels = NNSelectKernels();
+	nn->layer[nn->layerCount].external = 0;
+	if (nn->layerCount == 0) {
+		nn->inputCount = inputCount;
+	}
+	nn->outputCount = outputCount;
+	nn->layerCount++;
+}
+
 // add a layer, returning 1 for success or 0 for failure
 int NNAddLayer(NN *nn,
 	int inputCount, int outputCount, NNActivation activation) {
@@ -58,6 +137,20 @@ int NNAddLayer(NN *nn,
 		return 0;
 	}
 
+	nn->layer[nn->layerCount].nonZeroCount = 0;
+	nn->layer[nn->layerCount].rowStart = NULL;
+	nn->layer[nn->layerCount].column = NULL;
+	nn->layer[nn->layerCount].Ws = NULL;
+
+	if (nn->arena) {
+		if (!addLayerToArena(nn, &nn->layer[nn->layerCount],
+			inputCount, outputCount)) {
+			return 0;
+		}
+		addLayerInfo(nn, inputCount, outputCount, activation);
+		return 1;
+	}
+
 	int dataCount = inputCount * outputCount // w
 		+ outputCount   // b
 		+ (nn->layerCount == 0 ? inputCount : 0) // input
@@ -77,14 +170,140 @@ int NNAddLayer(NN *nn,
 		nn->layer[nn->layerCount].output = nn->layer[nn->layerCount].B + outputCount;
 	}
 
-	nn->layer[nn->layerCount].inputCount = inputCount;
-	nn->layer[nn->layerCount].outputCount = outputCount;
-	nn->layer[nn->layerCount].activation = activation;
+	addLayerInfo(nn, inputCount, outputCount, activation);
+	return 1;
+}
+
+// add a sparse layer, returning 1 for success or 0 for failure
+int NNAddSparseLayer(NN *nn,
+	int inputCount, int outputCount, int nonZeroCount, NNActivation activation) {
+	if (nn->arena || nn->layerCount >= nn->maxLayerCount
+		|| inputCount <= 0 || outputCount <= 0 || nonZeroCount < 0) {
+		return 0;
+	}
+
+	NNLayer *layer = &nn->layer[nn->layerCount];
+	int dataCount = outputCount   // b
+		+ (nn->layerCount == 0 ? inputCount : 0) // input
+		+ outputCount   // output
+		+ nonZeroCount;	// nonzero weights
+	int indexCount = outputCount + 1	// rowStart
+		+ nonZeroCount;	// column
+	layer->data = (NNFloat *)malloc(dataCount * sizeof(NNFloat)
+		+ indexCount * sizeof(int));
+	if (!layer->data) {
+		return 0;
+	}
+
+	layer->W = NULL;
+	layer->B = layer->data;
 	if (nn->layerCount == 0) {
-		nn->inputCount = inputCount;
+		layer->input = layer->B + outputCount;
+		layer->output = layer->input + inputCount;
+	} else {
+		layer->input = NULL;
+		layer->output = layer->B + outputCount;
 	}
-	nn->outputCount = outputCount;
-	nn->layerCount++;
+	layer->Ws = layer->output + outputCount;
+	layer->rowStart = (int *)(layer->Ws + nonZeroCount);
+	layer->column = layer->rowStart + outputCount + 1;
+	layer->nonZeroCount = nonZeroCount;
+
+	// zero weights in the last row until set by NNSparseSetWeights
+	for (int i = 0; i <= outputCount; i++) {
+		layer->rowStart[i] = 0;
+	}
+	layer->rowStart[outputCount] = nonZeroCount;
+	for (int i = 0; i < nonZeroCount; i++) {
+		layer->column[i] = 0;
+		layer->Ws[i] = 0;
+	}
+
+	addLayerInfo(nn, inputCount, outputCount, activation);
+	return 1;
+}
+
+// add a layer with weights and offsets stored by the caller, returning 1
+// for success or 0 for failure
+int NNAddExternalLayer(NN *nn, int inputCount, int outputCount,
+	NNActivation activation, NNFloat const *W, NNFloat const *B) {
+	if (nn->arena || nn->layerCount >= nn->maxLayerCount
+		|| inputCount <= 0 || outputCount <= 0) {
+		return 0;
+	}
+
+	NNLayer *layer = &nn->layer[nn->layerCount];
+	int dataCount = (nn->layerCount == 0 ? inputCount : 0) // input
+		+ outputCount;	// output
+	layer->data = (NNFloat *)malloc(dataCount * sizeof(NNFloat));
+	if (!layer->data) {
+		return 0;
+	}
+
+	layer->nonZeroCount = 0;
+	layer->rowStart = NULL;
+	layer->column = NULL;
+	layer->Ws = NULL;
+	// W and B are never written through an external layer
+	layer->W = (NNFloat *)W;
+	layer->B = (NNFloat *)B;
+	if (nn->layerCount == 0) {
+		layer->input = layer->data;
+		layer->output = layer->input + inputCount;
+	} else {
+		layer->input = NULL;
+		layer->output = layer->data;
+	}
+
+	addLayerInfo(nn, inputCount, outputCount, activation);
+	layer->external = 1;
+	return 1;
+}
+
+int NNSparseConvert(NN *dest, NN const *src) {
+	if (!NNReset(dest, src->layerCount)) {
+		return 0;
+	}
+	dest->accuracy = src->accuracy;
+	dest->optimizer = src->optimizer;
+	memcpy(dest->random, src->random, sizeof(dest->random));
+
+	for (int k = 0; k < src->layerCount; k++) {
+		NNLayer const *layer = &src->layer[k];
+		NNLayer *layerDest = &dest->layer[k];
+		int weightCount = layer->outputCount * layer->inputCount;
+		if (layer->W) {
+			int nonZeroCount = NNLayerNonZeroCount(layer);
+			int sparseSize = nonZeroCount * (sizeof(NNFloat) + sizeof(int))
+				+ (layer->outputCount + 1) * sizeof(int);
+			if (sparseSize < weightCount * (int)sizeof(NNFloat)) {
+				if (!NNAddSparseLayer(dest, layer->inputCount, layer->outputCount,
+					nonZeroCount, layer->activation)) {
+					return 0;
+				}
+				NNSparseSetWeights(layerDest, layer->W);
+			} else {
+				if (!NNAddLayer(dest, layer->inputCount, layer->outputCount,
+					layer->activation)) {
+					return 0;
+				}
+				memcpy(layerDest->W, layer->W, weightCount * sizeof(NNFloat));
+			}
+		} else {
+			if (!NNAddSparseLayer(dest, layer->inputCount, layer->outputCount,
+				layer->nonZeroCount, layer->activation)) {
+				return 0;
+			}
+			memcpy(layerDest->rowStart, layer->rowStart,
+				(layer->outputCount + 1) * sizeof(int));
+			memcpy(layerDest->column, layer->column,
+				layer->nonZeroCount * sizeof(int));
+			memcpy(layerDest->Ws, layer->Ws,
+				layer->nonZeroCount * sizeof(NNFloat));
+		}
+		memcpy(layerDest->B, layer->B, layer->outputCount * sizeof(NNFloat));
+	}
+
 	return 1;
 }
 
@@ -102,18 +321,55 @@ int NNBackPropAllocStorage(NN *nn, void **backpropTempMem) {
 	return 1;
 }
 
+int NNFixedAllocStorage(NN *nn, void **fixedMem) {
+	if (*fixedMem) {
+		free((void *)*fixedMem);
+		*fixedMem = NULL;
+	}
+	if (nn) {
+		int size = NNFixedMemorySize(nn);
+		*fixedMem = malloc(size);
+		if (!*fixedMem)
+			return 0;
+	}
+	return 1;
+}
+
+int NNQuantAllocStorage(NN *nn, void **quantMem) {
+	if (*quantMem) {
+		free((void *)*quantMem);
+		*quantMem = NULL;
+	}
+	if (nn) {
+		int size = NNQuantMemorySize(nn);
+		*quantMem = malloc(size);
+		if (!*quantMem)
+			return 0;
+	}
+	return 1;
+}
+
 int NNObservationsInit(NNObservations *obs, int inputCount, int outputCount,
 	int maxObsCount) {
 	if (obs->data) {
-		free((void *)obs->data);
+		if (!obs->external) {
+			free((void *)obs->data);
+		}
 		obs->data = NULL;
+		obs->priority = NULL;
 		obs->maxCount = 0;
+		obs->count = 0;
 	}
+	obs->external = 0;
+	obs->ring = 0;
+	obs->next = 0;
 	if (outputCount > 0) {
-		obs->data = malloc((inputCount + outputCount) * maxObsCount * sizeof(NNFloat));
+		// input and output data, then priorities
+		obs->data = malloc((inputCount + outputCount + 1) * maxObsCount * sizeof(NNFloat));
 		if (!obs->data) {
 			return 0;
 		}
+		obs->priority = obs->data + (inputCount + outputCount) * maxObsCount;
 		obs->maxCount = maxObsCount;
 		obs->count = 0;
 		obs->inputCount = inputCount;
@@ -121,3 +377,45 @@ int NNObservationsInit(NNObservations *obs, int inputCount, int outputCount,
 	}
 	return 1;
 }
+
+int NNObservationsInitExternal(NNObservations *obs, int inputCount, int outputCount,
+	int count, NNFloat *data, NNFloat *priority) {
+	if (!NNObservationsInit(obs, 0, 0, 0)) {
+		return 0;
+	}
+	obs->data = data;
+	obs->priority = priority;
+	obs->external = 1;
+	obs->maxCount = count;
+	obs->count = count;
+	obs->inputCount = inputCount;
+	obs->outputCount = outputCount;
+	return 1;
+}
+
+int NNObservationsResize(NNObservations *obs, int maxObsCount) {
+	if (obs->external) {
+		return 0;
+	}
+
+	int n = obs->inputCount + obs->outputCount;
+	int count = obs->count < maxObsCount ? obs->count : maxObsCount;
+	NNFloat *data = malloc((n + 1) * maxObsCount * sizeof(NNFloat));
+	if (!data) {
+		return 0;
+	}
+	NNFloat *priority = data + n * maxObsCount;
+	if (obs->data) {
+		memcpy(data, obs->data, n * count * sizeof(NNFloat));
+		memcpy(priority, obs->priority, count * sizeof(NNFloat));
+		free((void *)obs->data);
+	}
+	obs->data = data;
+	obs->priority = priority;
+	obs->maxCount = maxObsCount;
+	obs->count = count;
+	if (obs->next >= maxObsCount) {
+		obs->next = 0;
+	}
+	return 1;
+}
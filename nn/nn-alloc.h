@@ -19,17 +19,61 @@ extern "C" {
 // reset nn to empty, returning 1 for success or 0 for failure
 int NNReset(NN *nn, int maxLayerCount);
 
+// reset nn to empty and allocate a single block of memory for layerCount
+// layers of size[0] inputs and size[k+1] outputs in layer k, which must
+// then be added with NNAddLayer; returns 1 for success or 0 for failure
+int NNResetArena(NN *nn, int layerCount, int const *size);
+
 // add a layer, returning 1 for success or 0 for failure
 int NNAddLayer(NN *nn,
 	int inputCount, int outputCount, NNActivation activation);
 
+// add a sparse layer with room for nonZeroCount weights (set with
+// NNSparseSetWeights), which can be evaluated but not trained; not
+// supported with NNResetArena; returns 1 for success or 0 for failure
+int NNAddSparseLayer(NN *nn,
+	int inputCount, int outputCount, int nonZeroCount, NNActivation activation);
+
+// add a dense layer whose weights and offsets are stored by the caller in W
+// and B (e.g. in flash or in a mapped file), with only its outputs (and its
+// inputs for the first layer) allocated; the layer is marked as external:
+// W and B are used by NNEval but never modified, and a network with external
+// layers cannot be trained (NNBackPropInit fails); not supported with
+// NNResetArena; returns 1 for success or 0 for failure
+int NNAddExternalLayer(NN *nn, int inputCount, int outputCount,
+	NNActivation activation, NNFloat const *W, NNFloat const *B);
+
+// copy src (typically after NNPrune) to dest, where layers are sparse if it
+// uses less memory, with the same state of the pseudorandom generator (so
+// that a seeded sequence continues), returning 1 for success or 0 for failure
+int NNSparseConvert(NN *dest, NN const *src);
+
 // alloc temporary storage for back propagation, or deallocate if nn is NULL
 int NNBackPropAllocStorage(NN *nn, void **backpropTempMem);
 
-// initialize observation (alloc if maxObsCount > 0, else dealloc)
+// alloc storage for fixed-point version of nn, or deallocate if nn is NULL
+int NNFixedAllocStorage(NN *nn, void **fixedMem);
+
+// alloc storage for int8 version of nn, or deallocate if nn is NULL
+int NNQuantAllocStorage(NN *nn, void **quantMem);
+
+// initialize observation (alloc if maxObsCount > 0, else dealloc), not in
+// ring mode
 int NNObservationsInit(NNObservations *obs, int inputCount, int outputCount,
 	int maxObsCount);
 
+// initialize count observations stored in data (laid out as if allocated by
+// NNObservationsInit) with their priorities, both owned by the caller (e.g.
+// a mapped file) and not freed by NNObservationsInit; returns 1 for success
+// or 0 for failure
+int NNObservationsInitExternal(NNObservations *obs, int inputCount, int outputCount,
+	int count, NNFloat *data, NNFloat *priority);
+
+// change the capacity of observations, keeping the first ones which fit;
+// returns 1 for success or 0 for failure (obs is unchanged), in particular
+// for external observations whose memory is owned by the caller
+int NNObservationsResize(NNObservations *obs, int maxObsCount);
+
 #if defined(__cplusplus)
 }
 #endif
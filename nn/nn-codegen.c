@@ -0,0 +1,186 @@
+/*
+	Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+	Miniature Mobile Robots group, Switzerland
+	Author: Yves Piguet
+
+	Licensed under the 3-Clause BSD License;
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+	https://opensource.org/licenses/BSD-3-Clause
+*/
+
+#include "nn-codegen.h"
+
+// number of values per line in arrays
+#define valuesPerLine 8
+
+// fractional bits of the argument of tanh (same as NNFixedEval)
+#define tanhShift 12
+
+// helper functions of the generated code, copied from nn-fixed.c (keep them
+// identical: test-nn-codegen compares both, also with saturated sums)
+
+static char const *tanhCode =
+	"// tanh of x in Q12, with linear interpolation in the table, in Q15\n"
+	"static inline int16_t tanhQ12(int32_t x) {\n"
+	"\tuint32_t a = x < 0 ? 0u - (uint32_t)x : (uint32_t)x;\n"
+	"\tint16_t y;\n"
+	"\tif (a >= %du) {\n"
+	"\t\ty = 32767;\n"
+	"\t} else {\n"
+	"\t\tint i = a >> 7;\n"
+	"\t\tint32_t f = a & 127;\n"
+	"\t\ty = tanhTable[i] + (((tanhTable[i + 1] - tanhTable[i]) * f + 64) >> 7);\n"
+	"\t}\n"
+	"\treturn x < 0 ? -y : y;\n"
+	"}\n"
+	"\n";
+
+static char const *shiftCode =
+	"// x * 2^-s with rounding and symmetric saturation to +/-INT32_MAX\n"
+	"static inline int32_t shiftRound(int32_t x, int s) {\n"
+	"\tif (s > 0) {\n"
+	"\t\tif (s >= 31) {\n"
+	"\t\t\treturn 0;\n"
+	"\t\t}\n"
+	"\t\tint32_t half = (int32_t)1 << (s - 1);\n"
+	"\t\treturn ((x > INT32_MAX - half ? INT32_MAX - half : x) + half) >> s;\n"
+	"\t} else if (s < 0) {\n"
+	"\t\tif (s <= -31 || x > (INT32_MAX >> -s)) {\n"
+	"\t\t\treturn x > 0 ? INT32_MAX : x < 0 ? -INT32_MAX : 0;\n"
+	"\t\t} else if (x < (INT32_MIN >> -s)) {\n"
+	"\t\t\treturn -INT32_MAX;\n"
+	"\t\t}\n"
+	"\t\treturn x * ((int32_t)1 << -s);\n"
+	"\t}\n"
+	"\treturn x;\n"
+	"}\n"
+	"\n"
+	"static inline int16_t saturate16(int32_t x) {\n"
+	"\treturn x > 32767 ? 32767 : x < -32768 ? -32768 : (int16_t)x;\n"
+	"}\n"
+	"\n";
+
+static char const *activationName(NNActivation activation) {
+	switch (activation) {
+	case NNActivationTanh:
+		return "tanh";
+	case NNActivationSigmoid:
+		return "sigmoid";
+	case NNActivationIdentity:
+	default:
+		return "identity";
+	}
+}
+
+// write n int16 or int32 values (one of a16 or a32 not NULL) as the
+// elements of an array initializer, indented by indent tabs
+static void writeValues(FILE *fp, int16_t const *a16, int32_t const *a32,
+	int n, int indent) {
+	for (int i = 0; i < n; i++) {
+		if (i % valuesPerLine == 0) {
+			fprintf(fp, "%s%.*s", i > 0 ? "\n" : "", indent, "\t\t\t\t");
+		} else {
+			fprintf(fp, " ");
+		}
+		fprintf(fp, "%ld%s", a16 ? (long)a16[i] : (long)a32[i], i + 1 < n ? "," : "");
+	}
+	fprintf(fp, "\n");
+}
+
+int NNFixedWriteC(NNFixed const *fnn, FILE *fp, char const *name) {
+	int useTanh = 0;
+	for (int k = 0; k < fnn->layerCount; k++) {
+		useTanh |= fnn->layer[k].activation == NNActivationTanh
+			|| fnn->layer[k].activation == NNActivationSigmoid;
+	}
+
+	// header
+	fprintf(fp, "// neural network %d", fnn->inputCount);
+	for (int k = 0; k < fnn->layerCount; k++) {
+		fprintf(fp, "-%d", fnn->layer[k].outputCount);
+	}
+	fprintf(fp, " generated by NNFixedWriteC\n"
+		"// %s(in, out): in has %d fractional bits, out has %d fractional bits\n"
+		"\n"
+		"#include <stdint.h>\n"
+		"\n",
+		name, fnn->layer[0].inputShift, fnn->layer[fnn->layerCount - 1].outputShift);
+
+	// helper functions
+	if (useTanh) {
+		int tableSize;
+		int16_t const *table = NNFixedTanhTable(&tableSize);
+		fprintf(fp, "// tanh(i / 32) in Q15\n"
+			"static int16_t const tanhTable[%d] = {\n", tableSize);
+		writeValues(fp, table, NULL, tableSize, 1);
+		fprintf(fp, "};\n\n");
+		fprintf(fp, tanhCode, (tableSize - 1) << 7);
+	}
+	fputs(shiftCode, fp);
+
+	// weights and offsets
+	for (int k = 0; k < fnn->layerCount; k++) {
+		NNFixedLayer const *layer = &fnn->layer[k];
+		fprintf(fp, "// layer %d: %d inputs, %d outputs, %s\n"
+			"static int16_t const W%d[%d][%d] = {\n",
+			k + 1, layer->inputCount, layer->outputCount,
+			activationName(layer->activation),
+			k, layer->outputCount, layer->inputCount);
+		for (int i = 0; i < layer->outputCount; i++) {
+			fprintf(fp, "\t{\n");
+			writeValues(fp, &layer->W[i * layer->inputCount], NULL,
+				layer->inputCount, 2);
+			fprintf(fp, "\t}%s\n", i + 1 < layer->outputCount ? "," : "");
+		}
+		fprintf(fp, "};\n"
+			"static int32_t const B%d[%d] = {\n",
+			k, layer->outputCount);
+		writeValues(fp, NULL, layer->B, layer->outputCount, 1);
+		fprintf(fp, "};\n\n");
+	}
+
+	// evaluation, with outputs of hidden layers in local arrays
+	fprintf(fp, "void %s(int16_t const *in, int16_t *out) {\n", name);
+	for (int k = 0; k + 1 < fnn->layerCount; k++) {
+		fprintf(fp, "\tint16_t y%d[%d];\n", k, fnn->layer[k].outputCount);
+	}
+	for (int k = 0; k < fnn->layerCount; k++) {
+		NNFixedLayer const *layer = &fnn->layer[k];
+		// names of input and output arrays
+		char x[16] = "in", y[16] = "out";
+		if (k > 0) {
+			snprintf(x, sizeof(x), "y%d", k - 1);
+		}
+		if (k + 1 < fnn->layerCount) {
+			snprintf(y, sizeof(y), "y%d", k);
+		}
+		int accShift = layer->inputShift + layer->wShift;
+		fprintf(fp, "\n"
+			"\tfor (int i = 0; i < %d; i++) {\n"
+			"\t\tint32_t acc = B%d[i];\n"
+			"\t\tfor (int j = 0; j < %d; j++) {\n"
+			"\t\t\tacc += (int32_t)W%d[i][j] * %s[j];\n"
+			"\t\t}\n",
+			layer->outputCount, k, layer->inputCount, k, x);
+		switch (layer->activation) {
+		case NNActivationTanh:
+			fprintf(fp, "\t\t%s[i] = tanhQ12(shiftRound(acc, %d));\n",
+				y, accShift - tanhShift);
+			break;
+		case NNActivationSigmoid:
+			fprintf(fp, "\t\t%s[i] = (int16_t)((32768 + (int32_t)tanhQ12(shiftRound(acc, %d))) >> 1);\n",
+				y, accShift + 1 - tanhShift);
+			break;
+		case NNActivationIdentity:
+		default:
+			fprintf(fp, "\t\t%s[i] = saturate16(shiftRound(acc, %d));\n",
+				y, accShift - layer->outputShift);
+			break;
+		}
+		fprintf(fp, "\t}\n");
+	}
+	fprintf(fp, "}\n");
+
+	return !ferror(fp);
+}
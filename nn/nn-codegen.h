@@ -0,0 +1,42 @@
+/*
+	Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+	Miniature Mobile Robots group, Switzerland
+	Author: Yves Piguet
+
+	Licensed under the 3-Clause BSD License;
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+	https://opensource.org/licenses/BSD-3-Clause
+*/
+
+/*
+Ahead-of-time code generation for a fixed-point neural network. The C source
+written by NNFixedWriteC is self-contained (it includes only stdint.h) and
+defines a single function
+	void name(int16_t const *in, int16_t *out)
+with the same results as NNFixedEval. Weights, offsets and the table of tanh
+are static const arrays, so that they can be stored in flash, and loops have
+constant bounds for the topology of the network; nothing is allocated.
+Other names are static, hence each network should be written to its own
+file.
+*/
+
+#ifndef __NN_CODEGEN_H
+#define __NN_CODEGEN_H
+
+#include "nn-fixed.h"
+#include <stdio.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// write to fp the C source of function name which evaluates fnn, returning
+// 1 for success or 0 for failure
+int NNFixedWriteC(NNFixed const *fnn, FILE *fp, char const *name);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,318 @@
+/*
+	Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+	Miniature Mobile Robots group, Switzerland
+	Author: Yves Piguet
+
+	Licensed under the 3-Clause BSD License;
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+	https://opensource.org/licenses/BSD-3-Clause
+*/
+
+#include "nn-dataset.h"
+#include "nn-alloc.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// header of binary files
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint32_t dtype;
+	int32_t inputCount;
+	int32_t outputCount;
+	int32_t count;
+	uint32_t reserved[2];
+} BinaryHeader;
+
+#define binaryMagic "NNOB"
+#define binaryVersion 1
+#define binaryDTypeFloat32 1
+
+// number of bytes used to estimate the number of observations
+#define estimateSampleSize 65536
+
+// largest length of numbers parsed by strtod when they are not exact in
+// the fast path of parseNumber
+#define numberLengthMax 64
+
+// powers of 10 which are exact in double
+static double const pow10Exact[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static int isSeparator(char c) {
+	return c == ',' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static int isDigit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+// parse a decimal number with optional sign, fraction and exponent at p
+// (before end), returning the address after it, or NULL if there is none;
+// when the significant digits fit in a mantissa of at most 2^53 and the
+// exponent is within +/-22, both are exact in double and the result is
+// correctly rounded; other numbers are parsed by strtod, or approximated
+// with pow if they are longer than numberLengthMax
+static char const *parseNumber(char const *p, char const *end, double *x) {
+	char const *start = p;
+	int negative = 0;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p++ == '-';
+	}
+
+	uint64_t mantissa = 0;
+	int digitCount = 0;	// significant digits in mantissa
+	int exponent = 0;
+	int any = 0;
+	for (; p < end && isDigit(*p); p++) {
+		any = 1;
+		if (digitCount < 19) {
+			mantissa = 10 * mantissa + (*p - '0');
+			digitCount += mantissa > 0;
+		} else {
+			exponent++;	// digit beyond precision
+		}
+	}
+	if (p < end && *p == '.') {
+		for (p++; p < end && isDigit(*p); p++) {
+			any = 1;
+			if (digitCount < 19) {
+				mantissa = 10 * mantissa + (*p - '0');
+				digitCount += mantissa > 0;
+				exponent--;
+			}
+		}
+	}
+	if (!any) {
+		return NULL;
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		int expNegative = 0;
+		if (p < end && (*p == '-' || *p == '+')) {
+			expNegative = *p++ == '-';
+		}
+		if (p >= end || !isDigit(*p)) {
+			return NULL;
+		}
+		int e = 0;
+		for (; p < end && isDigit(*p); p++) {
+			if (e < 10000) {
+				e = 10 * e + (*p - '0');
+			}
+		}
+		exponent += expNegative ? -e : e;
+	}
+
+	double r = (double)mantissa;
+	if (mantissa == 0) {
+		// 0 whatever the exponent
+	} else if (mantissa <= (uint64_t)1 << 53 && exponent >= 0 && exponent <= 22) {
+		r *= pow10Exact[exponent];
+	} else if (mantissa <= (uint64_t)1 << 53 && exponent < 0 && exponent >= -22) {
+		r /= pow10Exact[-exponent];
+	} else if (p - start < numberLengthMax) {
+		// rare: copy with a terminating nul for strtod
+		char str[numberLengthMax];
+		memcpy(str, start, p - start);
+		str[p - start] = '\0';
+		*x = strtod(str, NULL);
+		return p;
+	} else {
+		r *= pow(10, exponent);
+	}
+	*x = negative ? -r : r;
+	return p;
+}
+
+// parse CSV data in memory
+static int parseCSV(NNObservations *obs, char const *p, char const *end) {
+	int n = obs->inputCount + obs->outputCount;
+	NNFloat ringRow[n];
+	NNFloat *row = ringRow;	// values of the current observation
+	int i = 0;
+
+	// capacity estimated from the number of rows at the beginning
+	if (!obs->ring) {
+		long sampleSize = end - p < estimateSampleSize ? end - p : estimateSampleSize;
+		long rowCount = 1;
+		for (long k = 0; k < sampleSize; k++) {
+			rowCount += p[k] == '\n';
+		}
+		long estimate = obs->count + (long)((double)(end - p) * rowCount / sampleSize) + 1;
+		if (estimate > obs->maxCount && estimate < INT32_MAX / (n + 1)
+			&& !NNObservationsResize(obs, (int)estimate)) {
+			return 0;
+		}
+	}
+
+	while (1) {
+		while (p < end && isSeparator(*p)) {
+			p++;
+		}
+		if (p >= end) {
+			return 1;
+		}
+		double x;
+		p = parseNumber(p, end, &x);
+		if (p == NULL || (p < end && !isSeparator(*p))) {
+			return 0;
+		}
+
+		if (i == 0 && !obs->ring) {
+			// parse directly into obs, with geometric growth
+			if (obs->count >= obs->maxCount) {
+				int maxCount = obs->maxCount < 16 ? 32 : 2 * obs->maxCount;
+				if (!NNObservationsResize(obs, maxCount)) {
+					return 0;
+				}
+			}
+			row = &obs->data[obs->count * n];
+		}
+		row[i++] = (NNFloat)x;
+		if (i == n) {
+			i = 0;
+			if (obs->ring) {
+				if (NNObservationsAdd(obs, row, row + obs->inputCount) < 0) {
+					return 0;
+				}
+			} else {
+				obs->priority[obs->count++] = 1;
+			}
+		}
+	}
+}
+
+int NNObservationsLoadCSV(NNObservations *obs, char const *path) {
+	if (obs->inputCount + obs->outputCount <= 0) {
+		return 0;
+	}
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return 0;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return 0;
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		return 1;
+	}
+	void *mem = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mem == MAP_FAILED) {
+		return 0;
+	}
+	madvise(mem, st.st_size, MADV_SEQUENTIAL);
+
+	char const *p = (char const *)mem;
+	int status = parseCSV(obs, p, p + st.st_size);
+
+	munmap(mem, st.st_size);
+	return status;
+}
+
+// read the header of a binary file, returning 1 if it is valid
+static int readBinaryHeader(int fd, BinaryHeader *header) {
+	return read(fd, header, sizeof(*header)) == sizeof(*header)
+		&& memcmp(header->magic, binaryMagic, 4) == 0
+		&& header->version == binaryVersion
+		&& header->dtype == binaryDTypeFloat32 && sizeof(NNFloat) == 4
+		&& header->inputCount >= 0 && header->outputCount > 0
+		&& header->count >= 0;
+}
+
+// size of a binary file in bytes
+static size_t binarySize(BinaryHeader const *header) {
+	return sizeof(BinaryHeader) + (size_t)header->count
+		* (header->inputCount + header->outputCount) * sizeof(NNFloat);
+}
+
+int NNObservationsIsBinaryFile(char const *path) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return 0;
+	}
+	BinaryHeader header;
+	int isBinary = readBinaryHeader(fd, &header);
+	close(fd);
+	return isBinary;
+}
+
+int NNObservationsMapBinary(NNObservations *obs, char const *path) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return 0;
+	}
+	BinaryHeader header;
+	struct stat st;
+	if (!readBinaryHeader(fd, &header) || fstat(fd, &st) != 0
+		|| (size_t)st.st_size < binarySize(&header)) {
+		close(fd);
+		return 0;
+	}
+	void *mem = mmap(NULL, binarySize(&header), PROT_READ | PROT_WRITE,
+		MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mem == MAP_FAILED) {
+		return 0;
+	}
+
+	NNFloat *priority = malloc((header.count > 0 ? header.count : 1) * sizeof(NNFloat));
+	if (!priority) {
+		munmap(mem, binarySize(&header));
+		return 0;
+	}
+	for (int i = 0; i < header.count; i++) {
+		priority[i] = 1;
+	}
+	return NNObservationsInitExternal(obs, header.inputCount, header.outputCount,
+		header.count, (NNFloat *)((char *)mem + sizeof(BinaryHeader)), priority);
+}
+
+void NNObservationsUnmap(NNObservations *obs) {
+	if (obs->external && obs->data) {
+		char *mem = (char *)obs->data - sizeof(BinaryHeader);
+		BinaryHeader const *header = (BinaryHeader const *)mem;
+		munmap(mem, binarySize(header));
+		free(obs->priority);
+	}
+	NNObservationsInit(obs, 0, 0, 0);
+}
+
+int NNObservationsSaveBinary(NNObservations const *obs, char const *path) {
+	BinaryHeader header = {
+		{'N', 'N', 'O', 'B'},
+		binaryVersion,
+		binaryDTypeFloat32,
+		obs->inputCount,
+		obs->outputCount,
+		obs->count,
+		{0, 0}
+	};
+	if (sizeof(NNFloat) != 4) {
+		return 0;
+	}
+
+	FILE *fp = fopen(path, "wb");
+	if (fp == NULL) {
+		return 0;
+	}
+	size_t n = (size_t)obs->count * (obs->inputCount + obs->outputCount);
+	int ok = fwrite(&header, sizeof(header), 1, fp) == 1
+		&& fwrite(obs->data, sizeof(NNFloat), n, fp) == n;
+	return fclose(fp) == 0 && ok;
+}
@@ -0,0 +1,74 @@
+/*
+	Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+	Miniature Mobile Robots group, Switzerland
+	Author: Yves Piguet
+
+	Licensed under the 3-Clause BSD License;
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+	https://opensource.org/licenses/BSD-3-Clause
+*/
+
+/*
+Loading of datasets from files (POSIX, for hosts, not for the robot).
+CSV files contain decimal numbers separated by commas, spaces or newlines;
+they are read in a sequence of observations, each made of inputCount
+inputs followed by outputCount outputs, usually one per row. The file is
+mapped in memory and parsed in a single pass, without stdio. Numbers whose
+significant digits fit in a mantissa of at most 2^53, with a decimal
+exponent within +/-22, are converted exactly in a fast path; other numbers
+are parsed by strtod on a copy if they are shorter than 64 characters, or
+approximated with pow.
+
+Binary files (extension .nnob by convention) contain a header of 32 bytes
+followed by the observations laid out exactly like NNObservations data,
+so that they can be mapped in memory and used for training without being
+read or copied; pages are loaded on demand by the system. Values are in
+the byte order of the host. Header:
+	char magic[4]	"NNOB"
+	uint32_t version	1
+	uint32_t dtype	1 for float32 (NNFloat)
+	int32_t inputCount
+	int32_t outputCount
+	int32_t count	number of observations
+	uint32_t reserved[2]	0
+*/
+
+#ifndef __NN_DATASET_H
+#define __NN_DATASET_H
+
+#include "nn.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// append to obs (initialized by NNObservationsInit, possibly with a capacity
+// of 0) the observations of CSV file path; obs grows as needed, or replaces
+// its oldest observations in ring mode; an incomplete last observation is
+// ignored; returns 1 for success or 0 if the file cannot be read, memory
+// cannot be allocated or the file contains something else than numbers
+int NNObservationsLoadCSV(NNObservations *obs, char const *path);
+
+// check if file path is a binary dataset
+int NNObservationsIsBinaryFile(char const *path);
+
+// initialize obs with the observations of binary file path mapped in memory
+// (private copy-on-write mapping, so that obs can be shuffled or modified
+// in ring mode without changing the file), returning 1 for success or 0
+// for failure; obs must be released with NNObservationsUnmap
+int NNObservationsMapBinary(NNObservations *obs, char const *path);
+
+// unmap observations mapped by NNObservationsMapBinary and reset obs to
+// empty
+void NNObservationsUnmap(NNObservations *obs);
+
+// write observations to binary file path, returning 1 for success or 0 for
+// failure
+int NNObservationsSaveBinary(NNObservations const *obs, char const *path);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,247 @@
+/*
+	Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+	Miniature Mobile Robots group, Switzerland
+	Author: Yves Piguet
+
+	Licensed under the 3-Clause BSD License;
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+	https://opensource.org/licenses/BSD-3-Clause
+*/
+
+#include "nn-fixed.h"
+#include <math.h>
+
+// fractional bits of the argument of tanh
+#define NNFixedTanhShift 12
+
+// tanh(i / 32) in Q15 for i = 0..192 (saturated to 32767)
+static int16_t const tanhTable[] = {
+	0, 1024, 2045, 3063, 4075, 5079, 6073, 7056,
+	8025, 8980, 9919, 10840, 11743, 12625, 13486, 14326,
+	15143, 15936, 16706, 17452, 18173, 18870, 19542, 20189,
+	20813, 21411, 21986, 22538, 23066, 23571, 24054, 24516,
+	24956, 25376, 25776, 26157, 26519, 26864, 27191, 27502,
+	27797, 28076, 28341, 28592, 28830, 29055, 29268, 29470,
+	29660, 29840, 30010, 30170, 30322, 30465, 30600, 30727,
+	30847, 30960, 31067, 31167, 31262, 31351, 31435, 31515,
+	31589, 31659, 31726, 31788, 31846, 31901, 31953, 32002,
+	32048, 32091, 32132, 32170, 32206, 32240, 32271, 32301,
+	32329, 32356, 32381, 32404, 32426, 32447, 32466, 32484,
+	32501, 32517, 32532, 32547, 32560, 32573, 32584, 32596,
+	32606, 32616, 32625, 32634, 32642, 32649, 32657, 32663,
+	32670, 32676, 32681, 32686, 32691, 32696, 32700, 32704,
+	32708, 32712, 32715, 32718, 32721, 32724, 32727, 32729,
+	32732, 32734, 32736, 32738, 32740, 32741, 32743, 32745,
+	32746, 32747, 32749, 32750, 32751, 32752, 32753, 32754,
+	32755, 32755, 32756, 32757, 32758, 32758, 32759, 32759,
+	32760, 32760, 32761, 32761, 32762, 32762, 32762, 32763,
+	32763, 32763, 32764, 32764, 32764, 32764, 32765, 32765,
+	32765, 32765, 32765, 32766, 32766, 32766, 32766, 32766,
+	32766, 32766, 32766, 32767, 32767, 32767, 32767, 32767,
+	32767, 32767, 32767, 32767, 32767, 32767, 32767, 32767,
+	32767, 32767, 32767, 32767, 32767, 32767, 32767, 32767,
+	32767
+};
+
+// largest argument in the table, in Q12
+#define NNFixedTanhMax (((int32_t)(sizeof(tanhTable) / sizeof(tanhTable[0])) - 1) << 7)
+
+// largest number of fractional bits of weights
+#define NNFixedMaxWShift 24
+
+// tanh of x in Q12, with linear interpolation in the table, in Q15
+// (max error about 1.2e-4 + 1.2e-4 for the quantization of x)
+static int16_t tanhQ12(int32_t x) {
+	// unsigned magnitude, valid even for INT32_MIN
+	uint32_t a = x < 0 ? 0u - (uint32_t)x : (uint32_t)x;
+	int16_t y;
+	if (a >= (uint32_t)NNFixedTanhMax) {
+		y = 32767;
+	} else {
+		int i = a >> 7;	// table step is 1/32 = 128 in Q12
+		int32_t f = a & 127;
+		y = tanhTable[i] + (((tanhTable[i + 1] - tanhTable[i]) * f + 64) >> 7);
+	}
+	return x < 0 ? -y : y;
+}
+
+// x * 2^-s with rounding and symmetric saturation to +/-INT32_MAX
+static int32_t shiftRound(int32_t x, int s) {
+	if (s > 0) {
+		if (s >= 31) {
+			return 0;
+		}
+		// saturate so that adding half of the lsb does not overflow
+		int32_t half = (int32_t)1 << (s - 1);
+		return ((x > INT32_MAX - half ? INT32_MAX - half : x) + half) >> s;
+	} else if (s < 0) {
+		if (s <= -31 || x > (INT32_MAX >> -s)) {
+			return x > 0 ? INT32_MAX : x < 0 ? -INT32_MAX : 0;
+		} else if (x < (INT32_MIN >> -s)) {
+			return -INT32_MAX;
+		}
+		return x * ((int32_t)1 << -s);
+	}
+	return x;
+}
+
+static int16_t saturate16(int32_t x) {
+	return x > 32767 ? 32767 : x < -32768 ? -32768 : (int16_t)x;
+}
+
+// check that weights of layer with wShift fractional bits fit in int16
+// and sums for inputs bounded by xMaxFixed fit in int32
+static int fitsFixed(NNLayer const *layer, int wShift, int xShift,
+	NNFloat xMaxFixed) {
+	NNFloat wScale = ldexp(1, wShift);
+	for (int i = 0; i < layer->outputCount; i++) {
+		NNFloat p = fabs(round(layer->B[i] * ldexp(1, xShift + wShift)));
+		for (int j = 0; j < layer->inputCount; j++) {
+			NNFloat w = fabs(round(layer->W[i * layer->inputCount + j] * wScale));
+			if (w > 32767) {
+				return 0;
+			}
+			p += w * xMaxFixed;
+		}
+		if (p > 0x7fff0000) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int NNFixedMemorySize(NN const *nn) {
+	int size = nn->layerCount * sizeof(NNFixedLayer);
+	for (int k = 0; k < nn->layerCount; k++) {
+		size += nn->layer[k].outputCount * sizeof(int32_t)	// B
+			+ (nn->layer[k].inputCount + 1) * nn->layer[k].outputCount
+				* sizeof(int16_t);	// W, output
+	}
+	return size;
+}
+
+int NNFixedConvert(NNFixed *fnn, NN const *nn, void *mem,
+	int inputShift, NNFloat inputMax) {
+	if (NNHasSparseLayer(nn)) {
+		return 0;
+	}
+
+	// layout: layers, then B of all layers (int32), then W and outputs (int16)
+	fnn->layer = (NNFixedLayer *)mem;
+	int32_t *data32 = (int32_t *)(fnn->layer + nn->layerCount);
+	int16_t *data16 = (int16_t *)data32;
+	for (int k = 0; k < nn->layerCount; k++) {
+		data16 += 2 * nn->layer[k].outputCount;
+	}
+
+	fnn->layerCount = nn->layerCount;
+	fnn->inputCount = nn->inputCount;
+	fnn->outputCount = nn->outputCount;
+
+	NNFloat xMax = inputMax;	// bound on absolute value of input
+	int xShift = inputShift;
+	for (int k = 0; k < nn->layerCount; k++) {
+		NNLayer const *layer = &nn->layer[k];
+		NNFixedLayer *flayer = &fnn->layer[k];
+		flayer->inputCount = layer->inputCount;
+		flayer->outputCount = layer->outputCount;
+		flayer->activation = layer->activation;
+		flayer->B = data32;
+		data32 += layer->outputCount;
+		flayer->W = data16;
+		data16 += layer->inputCount * layer->outputCount;
+		flayer->output = data16;
+		data16 += layer->outputCount;
+
+		// bound on sums
+		NNFloat pMax = 0;
+		for (int i = 0; i < layer->outputCount; i++) {
+			NNFloat p = fabs(layer->B[i]);
+			for (int j = 0; j < layer->inputCount; j++) {
+				p += fabs(layer->W[i * layer->inputCount + j]) * xMax;
+			}
+			if (p > pMax) {
+				pMax = p;
+			}
+		}
+
+		// largest wShift such that W fits in int16 and sums in int32
+		NNFloat xMaxFixed = ceil(xMax * ldexp(1, xShift));
+		int wShift = NNFixedMaxWShift;
+		while (wShift > -15
+			&& !fitsFixed(layer, wShift, xShift, xMaxFixed)) {
+			wShift--;
+		}
+
+		flayer->inputShift = xShift;
+		flayer->wShift = wShift;
+		for (int i = 0; i < layer->outputCount; i++) {
+			flayer->B[i] = (int32_t)round(layer->B[i] * ldexp(1, xShift + wShift));
+		}
+		for (int i = 0; i < layer->inputCount * layer->outputCount; i++) {
+			flayer->W[i] = saturate16((int32_t)round(layer->W[i] * ldexp(1, wShift)));
+		}
+
+		switch (layer->activation) {
+		case NNActivationTanh:
+		case NNActivationSigmoid:
+			flayer->outputShift = 15;
+			xMax = 1;
+			break;
+		case NNActivationIdentity:
+		default:
+			// largest outputShift such that output fits in int16
+			flayer->outputShift = 15;
+			while (flayer->outputShift > -15
+				&& pMax * ldexp(1, flayer->outputShift) > 32767) {
+				flayer->outputShift--;
+			}
+			xMax = pMax;
+			break;
+		}
+		xShift = flayer->outputShift;
+	}
+
+	return 1;
+}
+
+int16_t const *NNFixedTanhTable(int *size) {
+	*size = sizeof(tanhTable) / sizeof(tanhTable[0]);
+	return tanhTable;
+}
+
+void NNFixedEval(NNFixed *fnn, int16_t const *input) {
+	for (int k = 0; k < fnn->layerCount; k++) {
+		NNFixedLayer *layer = &fnn->layer[k];
+		int16_t const *x = k == 0 ? input : fnn->layer[k - 1].output;
+		int accShift = layer->inputShift + layer->wShift;
+		for (int i = 0; i < layer->outputCount; i++) {
+			int16_t const *w = &layer->W[i * layer->inputCount];
+			int32_t acc = layer->B[i];
+			for (int j = 0; j < layer->inputCount; j++) {
+				acc += (int32_t)w[j] * x[j];
+			}
+			switch (layer->activation) {
+			case NNActivationTanh:
+				layer->output[i] = tanhQ12(shiftRound(acc,
+					accShift - NNFixedTanhShift));
+				break;
+			case NNActivationSigmoid:
+				// (1 + tanh(p / 2)) / 2
+				layer->output[i] = (int16_t)((32768 + (int32_t)tanhQ12(shiftRound(acc,
+					accShift + 1 - NNFixedTanhShift))) >> 1);
+				break;
+			case NNActivationIdentity:
+			default:
+				layer->output[i] = saturate16(shiftRound(acc,
+					accShift - layer->outputShift));
+				break;
+			}
+		}
+	}
+}
+
+int16_t *NNFixedGetOutputPtr(NNFixed const *fnn) {
+	return fnn->layer[fnn->layerCount - 1].output;
+}
@@ -0,0 +1,73 @@
+/*
+	Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+	Miniature Mobile Robots group, Switzerland
+	Author: Yves Piguet
+
+	Licensed under the 3-Clause BSD License;
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+	https://opensource.org/licenses/BSD-3-Clause
+*/
+
+/*
+Fixed-point neural network for evaluation on processors without FPU.
+Weights are int16 with a number of fractional bits chosen for each layer,
+sums are accumulated in int32 and activation functions tanh and sigmoid are
+interpolated in a table. Outputs of tanh and sigmoid layers are in Q15.
+A network is converted once from a trained NN by NNFixedConvert; then
+NNFixedEval uses only integer arithmetic.
+*/
+
+#ifndef __NN_FIXED_H
+#define __NN_FIXED_H
+
+#include "nn.h"
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct {
+	int inputCount;
+	int outputCount;
+	NNActivation activation;
+	int inputShift;	// number of fractional bits of input
+	int wShift;	// number of fractional bits of W
+	int outputShift;	// number of fractional bits of output
+	int16_t *W;	// W[i * inputCount + j] between input j and output i
+	int32_t *B;	// B[i], with inputShift + wShift fractional bits
+	int16_t *output;
+} NNFixedLayer;
+
+typedef struct {
+	int layerCount;
+	int inputCount;
+	int outputCount;
+	NNFixedLayer *layer;
+} NNFixed;
+
+// calculate amount of memory (in bytes) required for fixed-point version of nn
+int NNFixedMemorySize(NN const *nn);
+
+// convert nn to fixed point in mem (NNFixedMemorySize(nn) bytes), for inputs
+// with inputShift fractional bits and absolute value not larger than inputMax
+// (dense layers only), returning 1 for success or 0 for failure
+int NNFixedConvert(NNFixed *fnn, NN const *nn, void *mem,
+	int inputShift, NNFloat inputMax);
+
+// evaluate output of each layer from first to last (integer arithmetic only)
+void NNFixedEval(NNFixed *fnn, int16_t const *input);
+
+// get table of tanh used by NNFixedEval, tanh(i / 32) in Q15 for
+// i = 0..size-1
+int16_t const *NNFixedTanhTable(int *size);
+
+// get address of outputs of last layer
+int16_t *NNFixedGetOutputPtr(NNFixed const *fnn);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,439 @@
+/*
+	Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+	Miniature Mobile Robots group, Switzerland
+	Author: Yves Piguet
+
+	Licensed under the 3-Clause BSD License;
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+	https://opensource.org/licenses/BSD-3-Clause
+*/
+
+/*
+Vector kernels for NNEval and backprop. Portable kernels are always
+available; SSE2 and AVX2 kernels are compiled with gcc or clang on x86 and
+selected at run time if the cpu supports them. They assume NNFloat is float.
+Define NN_NO_SIMD to keep only portable kernels.
+*/
+
+#include "nn.h"
+#include <math.h>
+#include <stddef.h>
+
+#if !defined(NN_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) \
+	&& (defined(__x86_64__) || defined(__i386__))
+#	define NN_X86_SIMD
+#	include <immintrin.h>
+#endif
+
+// rational approximation of tanh: odd polynomial of degree 13 divided by
+// even polynomial of degree 6, on [-tanhRationalMax, tanhRationalMax]
+// (max error 4e-7)
+
+#define tanhRationalMax 7.90531110763549805f
+#define tanhRationalA1 4.89352455891786e-03f
+#define tanhRationalA3 6.37261928875436e-04f
+#define tanhRationalA5 1.48572235717979e-05f
+#define tanhRationalA7 5.12229709037114e-08f
+#define tanhRationalA9 -8.60467152213735e-11f
+#define tanhRationalA11 2.00018790482477e-13f
+#define tanhRationalA13 -2.76076847742355e-16f
+#define tanhRationalB0 4.89352518554385e-03f
+#define tanhRationalB2 2.26843463243900e-03f
+#define tanhRationalB4 1.18534705686654e-04f
+#define tanhRationalB6 1.19825839466702e-06f
+
+static NNFloat tanhRational(NNFloat x) {
+	if (x > tanhRationalMax) {
+		x = tanhRationalMax;
+	} else if (x < -tanhRationalMax) {
+		x = -tanhRationalMax;
+	}
+	NNFloat x2 = x * x;
+	NNFloat p = tanhRationalA13;
+	p = p * x2 + tanhRationalA11;
+	p = p * x2 + tanhRationalA9;
+	p = p * x2 + tanhRationalA7;
+	p = p * x2 + tanhRationalA5;
+	p = p * x2 + tanhRationalA3;
+	p = p * x2 + tanhRationalA1;
+	NNFloat q = tanhRationalB6;
+	q = q * x2 + tanhRationalB4;
+	q = q * x2 + tanhRationalB2;
+	q = q * x2 + tanhRationalB0;
+	return x * p / q;
+}
+
+// cubic Hermite interpolation of tanh in a table of tanh(i / tanhTableScale)
+// for i = 0..tanhTableSize, with derivatives 1 - tanh^2 (max error 2.3e-7)
+
+#define tanhTableScale 16
+#define tanhTableSize 128	// up to x = 8, where 1 - tanh(x) < 2.3e-7
+
+// tanh(i / tanhTableScale) rounded to float, constant so that it needs no
+// initialization (safe with threads) and can stay in flash
+static NNFloat const tanhTable[tanhTableSize + 1] = {
+	0.0f, 0.0624187477f, 0.124352999f, 0.185333207f, 0.244918659f,
+	0.302709728f, 0.3583574f, 0.411570042f, 0.462117165f, 0.509829998f,
+	0.554599702f, 0.596373558f, 0.635148942f, 0.670967102f, 0.703905582f,
+	0.734071493f, 0.761594176f, 0.786618829f, 0.809301078f, 0.829801917f,
+	0.848283648f, 0.864906609f, 0.879826725f, 0.893193364f, 0.905148268f,
+	0.915824533f, 0.925346196f, 0.933828056f, 0.941375554f, 0.948085308f,
+	0.954045236f, 0.959335268f, 0.964027584f, 0.968187213f, 0.971872747f,
+	0.975136697f, 0.978026092f, 0.980583072f, 0.982845008f, 0.984845519f,
+	0.986614287f, 0.988177836f, 0.98955977f, 0.99078083f, 0.991859734f,
+	0.992812812f, 0.993654609f, 0.994398117f, 0.995054781f, 0.995634556f,
+	0.99614656f, 0.996598542f, 0.996997654f, 0.997349977f, 0.997660995f,
+	0.997935534f, 0.998177886f, 0.998391807f, 0.998580635f, 0.998747349f,
+	0.998894453f, 0.999024272f, 0.999138892f, 0.999240041f, 0.999329329f,
+	0.999408066f, 0.999477625f, 0.999538958f, 0.999593139f, 0.999640942f,
+	0.999683142f, 0.999720335f, 0.999753237f, 0.999782205f, 0.999807775f,
+	0.999830365f, 0.999850333f, 0.999867916f, 0.999883413f, 0.999897122f,
+	0.999909222f, 0.999919891f, 0.999929309f, 0.999937594f, 0.999944925f,
+	0.999951422f, 0.999957085f, 0.999962151f, 0.999966621f, 0.999970496f,
+	0.999974012f, 0.999977052f, 0.999979734f, 0.999982119f, 0.999984205f,
+	0.999986053f, 0.999987721f, 0.999989152f, 0.999990404f, 0.999991536f,
+	0.999992549f, 0.999993443f, 0.999994218f, 0.999994874f, 0.99999547f,
+	0.999996006f, 0.999996483f, 0.999996901f, 0.999997258f, 0.999997556f,
+	0.999997854f, 0.999998093f, 0.999998331f, 0.99999851f, 0.999998689f,
+	0.999998868f, 0.999998987f, 0.999999106f, 0.999999225f, 0.999999285f,
+	0.999999404f, 0.999999464f, 0.999999523f, 0.999999583f, 0.999999642f,
+	0.999999702f, 0.999999702f, 0.999999762f, 0.999999762f
+};
+
+static NNFloat tanhInterp(NNFloat x) {
+	NNFloat a = (x < 0 ? -x : x) * tanhTableScale;
+	NNFloat y;
+	if (a >= tanhTableSize) {
+		y = 1;
+	} else {
+		int i = (int)a;
+		NNFloat t = a - i;
+		NNFloat y0 = tanhTable[i];
+		NNFloat y1 = tanhTable[i + 1];
+		NNFloat d0 = (1 - y0 * y0) / tanhTableScale;
+		NNFloat d1 = (1 - y1 * y1) / tanhTableScale;
+		// Hermite basis in Horner form
+		NNFloat dy = y1 - y0;
+		y = y0 + t * (d0 + t * (3 * dy - 2 * d0 - d1 + t * (d0 + d1 - 2 * dy)));
+	}
+	return x < 0 ? -y : y;
+}
+
+NNFloat NNTanh(NNFloat x, NNAccuracy accuracy) {
+	switch (accuracy) {
+	case NNAccuracyRational:
+		return tanhRational(x);
+	case NNAccuracyTable:
+		return tanhInterp(x);
+	case NNAccuracyExact:
+	default:
+		return tanh(x);
+	}
+}
+
+// y[i] = tanh(a * p[i]), with the choice of method done once
+static void tanhPortable(NNFloat *y, NNFloat const *p, int n, NNFloat a,
+	NNAccuracy accuracy) {
+	switch (accuracy) {
+	case NNAccuracyRational:
+		for (int i = 0; i < n; i++) {
+			y[i] = tanhRational(a * p[i]);
+		}
+		break;
+	case NNAccuracyTable:
+		for (int i = 0; i < n; i++) {
+			y[i] = tanhInterp(a * p[i]);
+		}
+		break;
+	case NNAccuracyExact:
+	default:
+		for (int i = 0; i < n; i++) {
+			y[i] = tanh(a * p[i]);
+		}
+		break;
+	}
+}
+
+// activation of a whole layer, with the choice of function done once
+
+static void activatePortable(NNFloat *y, NNFloat const *p, int n,
+	NNActivation activation, NNAccuracy accuracy) {
+	switch (activation) {
+	case NNActivationTanh:
+		tanhPortable(y, p, n, 1, accuracy);
+		break;
+	case NNActivationSigmoid:
+		// (1 + tanh(p / 2)) / 2
+		tanhPortable(y, p, n, 0.5, accuracy);
+		for (int i = 0; i < n; i++) {
+			y[i] = (1 + y[i]) / 2;
+		}
+		break;
+	case NNActivationIdentity:
+	default:
+		if (y != p) {
+			for (int i = 0; i < n; i++) {
+				y[i] = p[i];
+			}
+		}
+		break;
+	}
+}
+
+// portable kernels
+
+static NNFloat dotPortable(NNFloat const *a, NNFloat const *b, int n) {
+	NNFloat s = 0;
+	for (int i = 0; i < n; i++) {
+		s += a[i] * b[i];
+	}
+	return s;
+}
+
+static void axpyPortable(NNFloat *y, NNFloat const *x, int n, NNFloat a) {
+	for (int i = 0; i < n; i++) {
+		y[i] += a * x[i];
+	}
+}
+
+static NNFloat sparseDotPortable(NNFloat const *a, int const *index,
+	NNFloat const *x, int n) {
+	NNFloat s = 0;
+	for (int i = 0; i < n; i++) {
+		s += a[i] * x[index[i]];
+	}
+	return s;
+}
+
+static NNKernels const kernelsPortable = {
+	dotPortable,
+	axpyPortable,
+	sparseDotPortable,
+	activatePortable
+};
+
+#if defined(NN_X86_SIMD)
+
+// SSE2 kernels (4 floats per vector, unaligned data)
+
+__attribute__((target("sse2")))
+static NNFloat dotSSE2(NNFloat const *a, NNFloat const *b, int n) {
+	__m128 s0 = _mm_setzero_ps();
+	__m128 s1 = _mm_setzero_ps();
+	int i = 0;
+	for (; i + 8 <= n; i += 8) {
+		s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+		s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+	}
+	for (; i + 4 <= n; i += 4) {
+		s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	}
+	s0 = _mm_add_ps(s0, s1);
+	s0 = _mm_add_ps(s0, _mm_movehl_ps(s0, s0));
+	s0 = _mm_add_ss(s0, _mm_shuffle_ps(s0, s0, 1));
+	NNFloat s = _mm_cvtss_f32(s0);
+	for (; i < n; i++) {
+		s += a[i] * b[i];
+	}
+	return s;
+}
+
+__attribute__((target("sse2")))
+static void axpySSE2(NNFloat *y, NNFloat const *x, int n, NNFloat a) {
+	__m128 av = _mm_set1_ps(a);
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		_mm_storeu_ps(y + i,
+			_mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(av, _mm_loadu_ps(x + i))));
+	}
+	for (; i < n; i++) {
+		y[i] += a * x[i];
+	}
+}
+
+// rational approximation of tanh (see tanhRational)
+__attribute__((target("sse2")))
+static __m128 tanhRationalSSE2(__m128 x) {
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-tanhRationalMax)),
+		_mm_set1_ps(tanhRationalMax));
+	__m128 x2 = _mm_mul_ps(x, x);
+	__m128 p = _mm_set1_ps(tanhRationalA13);
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(tanhRationalA11));
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(tanhRationalA9));
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(tanhRationalA7));
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(tanhRationalA5));
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(tanhRationalA3));
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(tanhRationalA1));
+	__m128 q = _mm_set1_ps(tanhRationalB6);
+	q = _mm_add_ps(_mm_mul_ps(q, x2), _mm_set1_ps(tanhRationalB4));
+	q = _mm_add_ps(_mm_mul_ps(q, x2), _mm_set1_ps(tanhRationalB2));
+	q = _mm_add_ps(_mm_mul_ps(q, x2), _mm_set1_ps(tanhRationalB0));
+	return _mm_div_ps(_mm_mul_ps(x, p), q);
+}
+
+__attribute__((target("sse2")))
+static void activateSSE2(NNFloat *y, NNFloat const *p, int n,
+	NNActivation activation, NNAccuracy accuracy) {
+	if (accuracy != NNAccuracyRational
+		|| (activation != NNActivationTanh && activation != NNActivationSigmoid)) {
+		activatePortable(y, p, n, activation, accuracy);
+		return;
+	}
+	// sigmoid: (1 + tanh(p / 2)) / 2
+	int sigmoid = activation == NNActivationSigmoid;
+	__m128 a = _mm_set1_ps(sigmoid ? 0.5f : 1.0f);
+	__m128 half = _mm_set1_ps(0.5f);
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 t = tanhRationalSSE2(_mm_mul_ps(a, _mm_loadu_ps(p + i)));
+		if (sigmoid) {
+			t = _mm_add_ps(half, _mm_mul_ps(half, t));
+		}
+		_mm_storeu_ps(y + i, t);
+	}
+	activatePortable(y + i, p + i, n - i, activation, accuracy);
+}
+
+static NNKernels const kernelsSSE2 = {
+	dotSSE2,
+	axpySSE2,
+	sparseDotPortable,	// no gather in SSE2
+	activateSSE2
+};
+
+// AVX2 kernels (8 floats per vector, fused multiply-add, unaligned data)
+
+__attribute__((target("avx2,fma")))
+static NNFloat dotAVX2(NNFloat const *a, NNFloat const *b, int n) {
+	__m256 s0 = _mm256_setzero_ps();
+	__m256 s1 = _mm256_setzero_ps();
+	int i = 0;
+	for (; i + 16 <= n; i += 16) {
+		s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+		s1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), s1);
+	}
+	for (; i + 8 <= n; i += 8) {
+		s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+	}
+	s0 = _mm256_add_ps(s0, s1);
+	__m128 s = _mm_add_ps(_mm256_castps256_ps128(s0), _mm256_extractf128_ps(s0, 1));
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+	NNFloat r = _mm_cvtss_f32(s);
+	for (; i < n; i++) {
+		r += a[i] * b[i];
+	}
+	return r;
+}
+
+__attribute__((target("avx2,fma")))
+static void axpyAVX2(NNFloat *y, NNFloat const *x, int n, NNFloat a) {
+	__m256 av = _mm256_set1_ps(a);
+	int i = 0;
+	for (; i + 8 <= n; i += 8) {
+		_mm256_storeu_ps(y + i,
+			_mm256_fmadd_ps(av, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+	}
+	for (; i < n; i++) {
+		y[i] += a * x[i];
+	}
+}
+
+// rational approximation of tanh (see tanhRational)
+__attribute__((target("avx2,fma")))
+static __m256 tanhRationalAVX2(__m256 x) {
+	x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-tanhRationalMax)),
+		_mm256_set1_ps(tanhRationalMax));
+	__m256 x2 = _mm256_mul_ps(x, x);
+	__m256 p = _mm256_set1_ps(tanhRationalA13);
+	p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(tanhRationalA11));
+	p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(tanhRationalA9));
+	p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(tanhRationalA7));
+	p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(tanhRationalA5));
+	p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(tanhRationalA3));
+	p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(tanhRationalA1));
+	__m256 q = _mm256_set1_ps(tanhRationalB6);
+	q = _mm256_fmadd_ps(q, x2, _mm256_set1_ps(tanhRationalB4));
+	q = _mm256_fmadd_ps(q, x2, _mm256_set1_ps(tanhRationalB2));
+	q = _mm256_fmadd_ps(q, x2, _mm256_set1_ps(tanhRationalB0));
+	return _mm256_div_ps(_mm256_mul_ps(x, p), q);
+}
+
+__attribute__((target("avx2,fma")))
+static void activateAVX2(NNFloat *y, NNFloat const *p, int n,
+	NNActivation activation, NNAccuracy accuracy) {
+	if (accuracy != NNAccuracyRational
+		|| (activation != NNActivationTanh && activation != NNActivationSigmoid)) {
+		activatePortable(y, p, n, activation, accuracy);
+		return;
+	}
+	// sigmoid: (1 + tanh(p / 2)) / 2
+	int sigmoid = activation == NNActivationSigmoid;
+	__m256 a = _mm256_set1_ps(sigmoid ? 0.5f : 1.0f);
+	__m256 half = _mm256_set1_ps(0.5f);
+	int i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 t = tanhRationalAVX2(_mm256_mul_ps(a, _mm256_loadu_ps(p + i)));
+		if (sigmoid) {
+			t = _mm256_fmadd_ps(half, t, half);
+		}
+		_mm256_storeu_ps(y + i, t);
+	}
+	activatePortable(y + i, p + i, n - i, activation, accuracy);
+}
+
+__attribute__((target("avx2,fma")))
+static NNFloat sparseDotAVX2(NNFloat const *a, int const *index,
+	NNFloat const *x, int n) {
+	__m256 s0 = _mm256_setzero_ps();
+	int i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256i j = _mm256_loadu_si256((__m256i const *)(index + i));
+		s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i),
+			_mm256_i32gather_ps(x, j, sizeof(NNFloat)), s0);
+	}
+	__m128 s = _mm_add_ps(_mm256_castps256_ps128(s0), _mm256_extractf128_ps(s0, 1));
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+	NNFloat r = _mm_cvtss_f32(s);
+	for (; i < n; i++) {
+		r += a[i] * x[index[i]];
+	}
+	return r;
+}
+
+static NNKernels const kernelsAVX2 = {
+	dotAVX2,
+	axpyAVX2,
+	sparseDotAVX2,
+	activateAVX2
+};
+
+#endif
+
+NNKernels const *NNGetKernels(NNKernelSet set) {
+	switch (set) {
+	case NNKernelSetPortable:
+		return &kernelsPortable;
+#if defined(NN_X86_SIMD)
+	case NNKernelSetSSE2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("sse2") ? &kernelsSSE2 : NULL;
+	case NNKernelSetAVX2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")
+			? &kernelsAVX2 : NULL;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+NNKernels const *NNSelectKernels(void) {
+	NNKernels const *kernels = NNGetKernels(NNKernelSetAVX2);
+	if (kernels == NULL) {
+		kernels = NNGetKernels(NNKernelSetSSE2);
+	}
+	return kernels ? kernels : &kernelsPortable;
+}
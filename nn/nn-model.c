@@ -0,0 +1,257 @@
+/*
+	Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+	Miniature Mobile Robots group, Switzerland
+	Author: Yves Piguet
+
+	Licensed under the 3-Clause BSD License;
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+	https://opensource.org/licenses/BSD-3-Clause
+*/
+
+#include "nn-model.h"
+#include "nn-alloc.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint32_t dtype;
+	int32_t layerCount;
+	int32_t inputCount;
+	int32_t accuracy;
+	uint32_t reserved[2];
+} ModelHeader;
+
+typedef struct {
+	int32_t outputCount;
+	int32_t activation;
+	uint32_t reserved[2];
+} ModelLayer;
+
+#define modelMagic "NNMD"
+#define modelVersion 1
+#define modelDTypeFloat32 1
+
+// alignment of arrays in bytes, the same as in arenas
+#define modelAlignment NNArenaAlignment
+
+// n bytes rounded up to a multiple of modelAlignment
+static long modelRound(long n) {
+	return (n + modelAlignment - 1) & ~(long)(modelAlignment - 1);
+}
+
+// offset of W of the first layer
+static long modelDataOffset(int layerCount) {
+	return modelRound(sizeof(ModelHeader) + layerCount * sizeof(ModelLayer));
+}
+
+// size of the model of a network whose layers are described in layer[],
+// or -1 if they are invalid
+static long modelSize(int inputCount, int layerCount, ModelLayer const *layer) {
+	long size = modelDataOffset(layerCount);
+	for (int k = 0; k < layerCount; k++) {
+		if (inputCount <= 0 || layer[k].outputCount <= 0) {
+			return -1;
+		}
+		size += modelRound((long)inputCount * layer[k].outputCount * sizeof(NNFloat))
+			+ modelRound(layer[k].outputCount * sizeof(NNFloat));
+		inputCount = layer[k].outputCount;
+	}
+	return size;
+}
+
+int NNModelSize(NN const *nn) {
+	long size = modelDataOffset(nn->layerCount);
+	for (int k = 0; k < nn->layerCount; k++) {
+		NNLayer const *layer = &nn->layer[k];
+		if (!layer->W) {
+			return 0;
+		}
+		size += modelRound((long)layer->inputCount * layer->outputCount * sizeof(NNFloat))
+			+ modelRound(layer->outputCount * sizeof(NNFloat));
+	}
+	return size <= INT32_MAX ? (int)size : 0;
+}
+
+int NNModelWrite(NN const *nn, void *model) {
+	int size = NNModelSize(nn);
+	if (size <= 0 || sizeof(NNFloat) != 4) {
+		return 0;
+	}
+	memset(model, 0, size);
+
+	ModelHeader *header = (ModelHeader *)model;
+	memcpy(header->magic, modelMagic, 4);
+	header->version = modelVersion;
+	header->dtype = modelDTypeFloat32;
+	header->layerCount = nn->layerCount;
+	header->inputCount = nn->inputCount;
+	header->accuracy = nn->accuracy;
+
+	ModelLayer *modelLayer = (ModelLayer *)(header + 1);
+	char *data = (char *)model + modelDataOffset(nn->layerCount);
+	for (int k = 0; k < nn->layerCount; k++) {
+		NNLayer const *layer = &nn->layer[k];
+		modelLayer[k].outputCount = layer->outputCount;
+		modelLayer[k].activation = layer->activation;
+		long n = (long)layer->inputCount * layer->outputCount * sizeof(NNFloat);
+		memcpy(data, layer->W, n);
+		data += modelRound(n);
+		memcpy(data, layer->B, layer->outputCount * sizeof(NNFloat));
+		data += modelRound(layer->outputCount * sizeof(NNFloat));
+	}
+
+	return 1;
+}
+
+// check the header and layers of a model of size bytes
+static int modelCheck(void const *model, long size) {
+	ModelHeader const *header = (ModelHeader const *)model;
+	return size >= (long)sizeof(ModelHeader)
+		&& memcmp(header->magic, modelMagic, 4) == 0
+		&& header->version == modelVersion
+		&& header->dtype == modelDTypeFloat32 && sizeof(NNFloat) == 4
+		&& header->layerCount > 0 && header->layerCount < 65536
+		&& size >= modelDataOffset(header->layerCount)
+		&& modelSize(header->inputCount, header->layerCount,
+			(ModelLayer const *)(header + 1)) > 0
+		&& size >= modelSize(header->inputCount, header->layerCount,
+			(ModelLayer const *)(header + 1));
+}
+
+int NNModelRead(NN *nn, void const *model, int size, int external) {
+	if (((uintptr_t)model & 3) != 0 || !modelCheck(model, size)) {
+		return 0;
+	}
+	ModelHeader const *header = (ModelHeader const *)model;
+	ModelLayer const *modelLayer = (ModelLayer const *)(header + 1);
+	if (!NNReset(nn, header->layerCount)) {
+		return 0;
+	}
+
+	char const *data = (char const *)model + modelDataOffset(header->layerCount);
+	int inputCount = header->inputCount;
+	for (int k = 0; k < header->layerCount; k++) {
+		int outputCount = modelLayer[k].outputCount;
+		NNActivation activation = modelLayer[k].activation == NNActivationTanh
+			? NNActivationTanh
+			: modelLayer[k].activation == NNActivationSigmoid
+				? NNActivationSigmoid
+				: NNActivationIdentity;
+		long n = (long)inputCount * outputCount * sizeof(NNFloat);
+		NNFloat const *W = (NNFloat const *)data;
+		NNFloat const *B = (NNFloat const *)(data + modelRound(n));
+		if (external) {
+			if (!NNAddExternalLayer(nn, inputCount, outputCount, activation, W, B)) {
+				NNReset(nn, 0);
+				return 0;
+			}
+		} else {
+			if (!NNAddLayer(nn, inputCount, outputCount, activation)) {
+				NNReset(nn, 0);
+				return 0;
+			}
+			memcpy(nn->layer[k].W, W, n);
+			memcpy(nn->layer[k].B, B, outputCount * sizeof(NNFloat));
+		}
+		data += modelRound(n) + modelRound(outputCount * sizeof(NNFloat));
+		inputCount = outputCount;
+	}
+	NNSetAccuracy(nn, header->accuracy == NNAccuracyRational ? NNAccuracyRational
+		: header->accuracy == NNAccuracyTable ? NNAccuracyTable
+		: NNAccuracyExact);
+
+	return 1;
+}
+
+int NNSave(NN const *nn, char const *path) {
+	int size = NNModelSize(nn);
+	void *model = size > 0 ? malloc(size) : NULL;
+	if (!model || !NNModelWrite(nn, model)) {
+		free(model);
+		return 0;
+	}
+
+	FILE *fp = fopen(path, "wb");
+	int ok = fp != NULL && fwrite(model, 1, size, fp) == (size_t)size;
+	if (fp != NULL && fclose(fp) != 0) {
+		ok = 0;
+	}
+	free(model);
+	return ok;
+}
+
+int NNLoad(NN *nn, char const *path) {
+	FILE *fp = fopen(path, "rb");
+	if (fp == NULL) {
+		return 0;
+	}
+	long size = -1;
+	if (fseek(fp, 0, SEEK_END) == 0) {
+		size = ftell(fp);
+	}
+	void *model = size > 0 && size <= INT32_MAX ? malloc(size) : NULL;
+	int ok = model != NULL && fseek(fp, 0, SEEK_SET) == 0
+		&& fread(model, 1, size, fp) == (size_t)size
+		&& NNModelRead(nn, model, (int)size, 0);
+	fclose(fp);
+	free(model);
+	return ok;
+}
+
+int NNLoadMapped(NN *nn, char const *path, void **mapping) {
+	if (nn == NULL) {
+		// unmap
+		if (*mapping) {
+			// mapped with exactly the size of the model (see below)
+			ModelHeader const *header = (ModelHeader const *)*mapping;
+			munmap(*mapping, modelSize(header->inputCount, header->layerCount,
+				(ModelLayer const *)(header + 1)));
+			*mapping = NULL;
+		}
+		return 1;
+	}
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return 0;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0 || st.st_size > INT32_MAX) {
+		close(fd);
+		return 0;
+	}
+	void *mem = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mem == MAP_FAILED) {
+		close(fd);
+		return 0;
+	}
+
+	// map again exactly the model (without trailing bytes of the file), so
+	// that its size can be recovered from its header when it is unmapped
+	ModelHeader const *header = (ModelHeader const *)mem;
+	long size = modelCheck(mem, st.st_size)
+		? modelSize(header->inputCount, header->layerCount,
+			(ModelLayer const *)(header + 1))
+		: -1;
+	munmap(mem, st.st_size);
+	mem = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (mem == MAP_FAILED) {
+		return 0;
+	}
+	if (!NNModelRead(nn, mem, (int)size, 1)) {
+		munmap(mem, size);
+		return 0;
+	}
+	*mapping = mem;
+	return 1;
+}
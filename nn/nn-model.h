@@ -0,0 +1,82 @@
+/*
+	Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+	Miniature Mobile Robots group, Switzerland
+	Author: Yves Piguet
+
+	Licensed under the 3-Clause BSD License;
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+	https://opensource.org/licenses/BSD-3-Clause
+*/
+
+/*
+Binary format of trained networks (models), with their topology,
+activation functions, accuracy, weights and offsets. Values are in the byte
+order of the host:
+	header (32 bytes):
+		char magic[4]	"NNMD"
+		uint32_t version	1
+		uint32_t dtype	1 for float32 (NNFloat)
+		int32_t layerCount
+		int32_t inputCount
+		int32_t accuracy	NNAccuracy
+		uint32_t reserved[2]	0
+	for each layer (16 bytes):
+		int32_t outputCount
+		int32_t activation	NNActivation
+		uint32_t reserved[2]	0
+	padding to a multiple of 32 bytes
+	for each layer, W then B, each padded to a multiple of 32 bytes
+
+Arrays W and B are aligned like the buffers of NNResetArena, so that a
+model in read-only memory (flash, or a file mapped in memory by
+NNLoadMapped) can be evaluated directly by a network set up by
+NNModelRead without copying weights and offsets. Only networks with dense
+layers are supported.
+
+NNModelSize, NNModelWrite and NNModelRead work in memory and use only the
+functions of nn-alloc.h; NNSave, NNLoad and NNLoadMapped use files (stdio
+and POSIX mmap, for hosts).
+*/
+
+#ifndef __NN_MODEL_H
+#define __NN_MODEL_H
+
+#include "nn.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// size of the model of nn in bytes, or 0 if nn has sparse layers
+int NNModelSize(NN const *nn);
+
+// write the model of nn to model (NNModelSize(nn) bytes aligned on 4 bytes),
+// returning 1 for success or 0 for failure
+int NNModelWrite(NN const *nn, void *model);
+
+// reset nn to the network of model of size bytes, returning 1 for success
+// or 0 for failure; if external is nonzero, weights and offsets are not
+// copied and must stay valid in model while nn is used (read-only memory
+// is fine, since nn cannot be trained); model must be aligned on 4 bytes
+// (on 32 bytes for the best performance)
+int NNModelRead(NN *nn, void const *model, int size, int external);
+
+// save nn to file path, returning 1 for success or 0 for failure
+int NNSave(NN const *nn, char const *path);
+
+// reset nn to the network saved in file path, with its own copy of weights
+// and offsets, returning 1 for success or 0 for failure
+int NNLoad(NN *nn, char const *path);
+
+// reset nn to the network saved in file path, mapped read-only in memory
+// and returned in *mapping, returning 1 for success or 0 for failure;
+// nn can be evaluated but not trained; the mapping is released (after
+// NNReset) by NNLoadMapped(NULL, NULL, mapping)
+int NNLoadMapped(NN *nn, char const *path, void **mapping);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
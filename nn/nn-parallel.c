@@ -0,0 +1,264 @@
+/*
+	Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+	Miniature Mobile Robots group, Switzerland
+	Author: Yves Piguet
+
+	Licensed under the 3-Clause BSD License;
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+	https://opensource.org/licenses/BSD-3-Clause
+*/
+
+#include "nn-parallel.h"
+#include "nn-alloc.h"
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+	NNParallelPhaseGradients = 0,
+	NNParallelPhaseHogwild
+};
+
+// first index of part i of n parts of count elements
+static int partStart(int count, int n, int i) {
+	return (int)((long)count * i / n);
+}
+
+// sum gradients of all workers into worker[0], adding them always in the
+// same order; done by the calling thread, since the sum is much cheaper
+// than the gradients of a mini-batch and a parallel reduction would cost
+// a second synchronization of all threads
+static void reduce(NNParallel *par) {
+	NN *nn = par->nn;
+	NNBackProp *bp0 = &par->worker[0].bp;
+	for (int w = 1; w < par->threadCount; w++) {
+		NNBackProp const *bp = &par->worker[w].bp;
+		for (int k = 0; k < nn->layerCount; k++) {
+			int n = nn->layer[k].outputCount;
+			for (int i = 0; i < n; i++) {
+				bp0->Bg[k][i] += bp->Bg[k][i];
+			}
+			n *= nn->layer[k].inputCount;
+			for (int i = 0; i < n; i++) {
+				bp0->Wg[k][i] += bp->Wg[k][i];
+			}
+		}
+	}
+}
+
+// gradients of the part of the observations of the current phase
+static void gradients(NNParallel *par, int index) {
+	NNParallelWorker *worker = &par->worker[index];
+	NNFloat *nnInput = NNGetInputPtr(&worker->nn);
+	int i0 = partStart(par->count, par->threadCount, index);
+	int i1 = partStart(par->count, par->threadCount, index + 1);
+
+	NNBackPropResetGradients(&worker->nn, &worker->bp);
+	for (int i = i0; i < i1; i++) {
+		NNFloat *input, *output;
+		NNObservationGetPtr(par->obs, (par->first + i) % par->obs->count,
+			&input, &output);
+		memcpy(nnInput, input, worker->nn.inputCount * sizeof(NNFloat));
+		NNEval(&worker->nn, NULL);
+		NNBackPropAddGradientsAfterEval(&worker->nn, &worker->bp, output);
+	}
+}
+
+// backprop steps with the part of the observations of the current phase,
+// applied directly to the shared weights without synchronization
+static void hogwild(NNParallel *par, int index) {
+	NNParallelWorker *worker = &par->worker[index];
+	NNFloat *nnInput = NNGetInputPtr(&worker->nn);
+	int i0 = partStart(par->count, par->threadCount, index);
+	int i1 = partStart(par->count, par->threadCount, index + 1);
+
+	for (int i = i0; i < i1; i++) {
+		NNFloat *input, *output;
+		NNObservationGetPtr(par->obs, (par->first + i) % par->obs->count,
+			&input, &output);
+		memcpy(nnInput, input, worker->nn.inputCount * sizeof(NNFloat));
+		NNEval(&worker->nn, NULL);
+		NNBackPropResetGradients(&worker->nn, &worker->bp);
+		NNBackPropAddGradientsAfterEval(&worker->nn, &worker->bp, output);
+		NNBackPropApply(&worker->nn, &worker->bp, par->eta);
+	}
+}
+
+static void runPhaseWorker(NNParallel *par, int phase, int index) {
+	switch (phase) {
+	case NNParallelPhaseGradients:
+		gradients(par, index);
+		break;
+	case NNParallelPhaseHogwild:
+		hogwild(par, index);
+		break;
+	}
+}
+
+static void *workerThread(void *arg) {
+	NNParallelWorker *worker = (NNParallelWorker *)arg;
+	NNParallel *par = worker->par;
+	int index = worker - par->worker;
+	int generation = 0;
+
+	for (;;) {
+		pthread_mutex_lock(&par->mutex);
+		while (par->generation == generation && !par->quit) {
+			pthread_cond_wait(&par->start, &par->mutex);
+		}
+		if (par->quit) {
+			pthread_mutex_unlock(&par->mutex);
+			return NULL;
+		}
+		generation = par->generation;
+		int phase = par->phase;
+		pthread_mutex_unlock(&par->mutex);
+
+		runPhaseWorker(par, phase, index);
+
+		pthread_mutex_lock(&par->mutex);
+		if (--par->pending == 0) {
+			pthread_cond_signal(&par->done);
+		}
+		pthread_mutex_unlock(&par->mutex);
+	}
+}
+
+// run a phase in all threads and wait until they have all completed it
+static void runPhase(NNParallel *par, int phase) {
+	if (par->threadCount == 1) {
+		runPhaseWorker(par, phase, 0);
+		return;
+	}
+
+	pthread_mutex_lock(&par->mutex);
+	par->phase = phase;
+	par->pending = par->threadCount - 1;
+	par->generation++;
+	pthread_cond_broadcast(&par->start);
+	pthread_mutex_unlock(&par->mutex);
+
+	runPhaseWorker(par, phase, 0);
+
+	pthread_mutex_lock(&par->mutex);
+	while (par->pending > 0) {
+		pthread_cond_wait(&par->done, &par->mutex);
+	}
+	pthread_mutex_unlock(&par->mutex);
+}
+
+// initialize copy of nn which shares W and B with the original
+static int initWorkerNN(NNParallelWorker *worker, NN *nn) {
+	int dataCount = nn->inputCount;
+	for (int k = 0; k < nn->layerCount; k++) {
+		dataCount += nn->layer[k].outputCount;
+	}
+
+	worker->nn = *nn;
+	worker->nn.layer = (NNLayer *)malloc(nn->layerCount * sizeof(NNLayer));
+	worker->data = (NNFloat *)malloc(dataCount * sizeof(NNFloat));
+	if (!worker->nn.layer || !worker->data) {
+		return 0;
+	}
+
+	NNFloat *data = worker->data;
+	for (int k = 0; k < nn->layerCount; k++) {
+		worker->nn.layer[k] = nn->layer[k];
+		worker->nn.layer[k].data = NULL;
+		if (k == 0) {
+			worker->nn.layer[k].input = data;
+			data += nn->inputCount;
+		}
+		worker->nn.layer[k].output = data;
+		data += nn->layer[k].outputCount;
+	}
+
+	return NNBackPropAllocStorage(&worker->nn, &worker->backpropTempMem)
+		&& NNBackPropInit(&worker->nn, &worker->bp, worker->backpropTempMem);
+}
+
+int NNParallelInit(NNParallel *par, NN *nn, int threadCount) {
+	par->nn = nn;
+	par->threadCount = 0;
+	par->generation = 0;
+	par->pending = 0;
+	par->quit = 0;
+	par->worker = (NNParallelWorker *)calloc(threadCount, sizeof(NNParallelWorker));
+	if (!par->worker) {
+		return 0;
+	}
+	pthread_mutex_init(&par->mutex, NULL);
+	pthread_cond_init(&par->start, NULL);
+	pthread_cond_init(&par->done, NULL);
+	par->threadCount = threadCount;
+
+	for (int i = 0; i < threadCount; i++) {
+		par->worker[i].par = par;
+		if (!initWorkerNN(&par->worker[i], nn)) {
+			NNParallelFree(par);
+			return 0;
+		}
+		// independent pseudorandom streams
+		for (int j = 0; j <= i; j++) {
+			NNRandomJump(&par->worker[i].nn);
+		}
+	}
+
+	for (int i = 1; i < threadCount; i++) {
+		if (pthread_create(&par->worker[i].thread, NULL,
+			workerThread, &par->worker[i]) != 0) {
+			NNParallelFree(par);
+			return 0;
+		}
+		par->worker[i].threadStarted = 1;
+	}
+
+	return 1;
+}
+
+void NNParallelFree(NNParallel *par) {
+	if (!par->worker) {
+		return;
+	}
+
+	pthread_mutex_lock(&par->mutex);
+	par->quit = 1;
+	pthread_cond_broadcast(&par->start);
+	pthread_mutex_unlock(&par->mutex);
+
+	for (int i = 0; i < par->threadCount; i++) {
+		NNParallelWorker *worker = &par->worker[i];
+		if (worker->threadStarted) {
+			pthread_join(worker->thread, NULL);
+		}
+		NNBackPropAllocStorage(NULL, &worker->backpropTempMem);
+		free(worker->nn.layer);
+		free(worker->data);
+	}
+
+	pthread_cond_destroy(&par->done);
+	pthread_cond_destroy(&par->start);
+	pthread_mutex_destroy(&par->mutex);
+	free(par->worker);
+	par->worker = NULL;
+	par->threadCount = 0;
+}
+
+void NNParallelBatch(NNParallel *par, NNObservations *obs,
+	int first, int count, NNFloat eta) {
+	par->obs = obs;
+	par->first = first;
+	par->count = count;
+	runPhase(par, NNParallelPhaseGradients);
+	reduce(par);
+	NNBackPropApply(par->nn, &par->worker[0].bp, eta / count);
+}
+
+void NNParallelHogwild(NNParallel *par, NNObservations *obs,
+	int first, int count, NNFloat eta) {
+	par->obs = obs;
+	par->first = first;
+	par->count = count;
+	par->eta = eta;
+	runPhase(par, NNParallelPhaseHogwild);
+}
@@ -0,0 +1,100 @@
+/*
+	Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+	Miniature Mobile Robots group, Switzerland
+	Author: Yves Piguet
+
+	Licensed under the 3-Clause BSD License;
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+	https://opensource.org/licenses/BSD-3-Clause
+*/
+
+/*
+Data-parallel training with POSIX threads (for hosts, not for the robot).
+Each step of backprop splits a mini-batch of observations among threads.
+Each thread has its own copy of the network which shares weights and
+offsets with the original but has its own inputs and outputs, and its own
+backprop temporary memory. Gradients are summed in a fixed order, so that
+results do not depend on thread scheduling.
+
+Threads are synchronized once per mini-batch (wake-up and wait with a
+condition variable, typically tens of microseconds), after which the
+calling thread sums the gradients and applies them. This pays off only
+when the gradients of a mini-batch take much longer to calculate, i.e.
+with large networks or large mini-batches, and with at most one thread
+per core; with small networks and mini-batches, a single thread (or
+Hogwild mode) is faster.
+
+In Hogwild mode, each thread applies one step of backprop for each of its
+observations directly to the shared weights, without any synchronization
+or reduction: updates from different threads can overlap, which is
+acceptable for SGD with sparse gradients but makes results depend on
+scheduling.
+*/
+
+#ifndef __NN_PARALLEL_H
+#define __NN_PARALLEL_H
+
+#include "nn.h"
+#include <pthread.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct NNParallel NNParallel;
+
+typedef struct {
+	NNParallel *par;
+	NN nn;	// shares W and B with the original nn
+	NNBackProp bp;
+	void *backpropTempMem;
+	NNFloat *data;	// block of data for input and outputs of nn
+	pthread_t thread;
+	int threadStarted;
+} NNParallelWorker;
+
+struct NNParallel {
+	NN *nn;
+	int threadCount;
+	NNParallelWorker *worker;	// worker[0] runs in the calling thread
+
+	pthread_mutex_t mutex;
+	pthread_cond_t start;	// signaled when a new phase starts
+	pthread_cond_t done;	// signaled when all workers have completed a phase
+	int generation;	// incremented for each new phase
+	int pending;	// number of threads which have not completed the phase
+	int quit;
+
+	// current phase
+	int phase;
+	NNObservations *obs;
+	int first;
+	int count;
+	NNFloat eta;
+};
+
+// initialize and start threadCount - 1 threads, returning 1 for success
+// or 0 for failure
+int NNParallelInit(NNParallel *par, NN *nn, int threadCount);
+
+// stop threads and free memory
+void NNParallelFree(NNParallel *par);
+
+// apply one step of back propagation with the mean gradient of count
+// observations starting at first (wrapping around at obs->count),
+// calculated in parallel
+void NNParallelBatch(NNParallel *par, NNObservations *obs,
+	int first, int count, NNFloat eta);
+
+// apply one step of back propagation for each of count observations
+// starting at first (wrapping around at obs->count), shared among threads
+// which update weights concurrently without synchronization
+void NNParallelHogwild(NNParallel *par, NNObservations *obs,
+	int first, int count, NNFloat eta);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
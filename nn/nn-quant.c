@@ -0,0 +1,202 @@
+/*
+	Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+	Miniature Mobile Robots group, Switzerland
+	Author: Yves Piguet
+
+	Licensed under the 3-Clause BSD License;
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+	https://opensource.org/licenses/BSD-3-Clause
+*/
+
+#include "nn-quant.h"
+#include <math.h>
+
+#if !defined(NN_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) \
+	&& (defined(__x86_64__) || defined(__i386__))
+#	define NN_X86_SIMD
+#	include <immintrin.h>
+#endif
+
+// int8 x int8 -> int32 dot product kernels
+
+static int32_t dotPortable(int8_t const *a, int8_t const *b, int n) {
+	int32_t s = 0;
+	for (int i = 0; i < n; i++) {
+		s += (int32_t)a[i] * b[i];
+	}
+	return s;
+}
+
+#if defined(NN_X86_SIMD)
+
+// 16 int8 per step, extended to int16 and multiplied and added by pairs
+// (no overflow: |a b| <= 2^14)
+__attribute__((target("avx2")))
+static int32_t dotAVX2(int8_t const *a, int8_t const *b, int n) {
+	__m256i s = _mm256_setzero_si256();
+	int i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m256i a16 = _mm256_cvtepi8_epi16(_mm_loadu_si128((__m128i const *)(a + i)));
+		__m256i b16 = _mm256_cvtepi8_epi16(_mm_loadu_si128((__m128i const *)(b + i)));
+		s = _mm256_add_epi32(s, _mm256_madd_epi16(a16, b16));
+	}
+	__m128i s4 = _mm_add_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+	s4 = _mm_add_epi32(s4, _mm_shuffle_epi32(s4, 0x4e));
+	s4 = _mm_add_epi32(s4, _mm_shuffle_epi32(s4, 0xb1));
+	int32_t r = _mm_cvtsi128_si32(s4);
+	for (; i < n; i++) {
+		r += (int32_t)a[i] * b[i];
+	}
+	return r;
+}
+
+#endif
+
+static int32_t (*selectDot(void))(int8_t const *a, int8_t const *b, int n) {
+#if defined(NN_X86_SIMD)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return dotAVX2;
+	}
+#endif
+	return dotPortable;
+}
+
+static int maxInputCount(NN const *nn) {
+	int n = 0;
+	for (int k = 0; k < nn->layerCount; k++) {
+		if (nn->layer[k].inputCount > n) {
+			n = nn->layer[k].inputCount;
+		}
+	}
+	return n;
+}
+
+int NNQuantMemorySize(NN const *nn) {
+	int size = nn->layerCount * sizeof(NNQuantLayer)
+		+ nn->inputCount * sizeof(NNFloat);	// input
+	for (int k = 0; k < nn->layerCount; k++) {
+		size += nn->layer[k].outputCount
+				* (2 * sizeof(NNFloat) + sizeof(int32_t))	// B, output, rowSum
+			+ nn->layer[k].outputCount * nn->layer[k].inputCount;	// W
+	}
+	return size + maxInputCount(nn);	// inputQ
+}
+
+int NNQuantConvert(NNQuant *qnn, NN const *nn, void *mem) {
+	if (NNHasSparseLayer(nn)) {
+		return 0;
+	}
+
+	// layout: layers, then float and int32 data, then int8 data
+	qnn->layer = (NNQuantLayer *)mem;
+	NNFloat *data = (NNFloat *)(qnn->layer + nn->layerCount);
+	qnn->input = data;
+	data += nn->inputCount;
+	for (int k = 0; k < nn->layerCount; k++) {
+		qnn->layer[k].B = data;
+		data += nn->layer[k].outputCount;
+		qnn->layer[k].output = data;
+		data += nn->layer[k].outputCount;
+		qnn->layer[k].rowSum = (int32_t *)data;
+		data += nn->layer[k].outputCount;
+	}
+	int8_t *data8 = (int8_t *)data;
+	qnn->inputQ = data8;
+	data8 += maxInputCount(nn);
+
+	qnn->layerCount = nn->layerCount;
+	qnn->inputCount = nn->inputCount;
+	qnn->outputCount = nn->outputCount;
+	qnn->accuracy = nn->accuracy;
+	qnn->kernels = NNSelectKernels();
+	qnn->dot = selectDot();
+
+	for (int k = 0; k < nn->layerCount; k++) {
+		NNLayer const *layer = &nn->layer[k];
+		NNQuantLayer *qlayer = &qnn->layer[k];
+		int weightCount = layer->outputCount * layer->inputCount;
+		qlayer->inputCount = layer->inputCount;
+		qlayer->outputCount = layer->outputCount;
+		qlayer->activation = layer->activation;
+		qlayer->W = data8;
+		data8 += weightCount;
+
+		// symmetric quantization of W with scale max|W| / 127
+		NNFloat wMax = 0;
+		for (int i = 0; i < weightCount; i++) {
+			if (fabs(layer->W[i]) > wMax) {
+				wMax = fabs(layer->W[i]);
+			}
+		}
+		qlayer->wScale = wMax > 0 ? wMax / 127 : 1;
+		for (int i = 0; i < layer->outputCount; i++) {
+			qlayer->rowSum[i] = 0;
+			for (int j = 0; j < layer->inputCount; j++) {
+				int8_t w = (int8_t)lrint(layer->W[i * layer->inputCount + j]
+					/ qlayer->wScale);
+				qlayer->W[i * layer->inputCount + j] = w;
+				qlayer->rowSum[i] += w;
+			}
+			qlayer->B[i] = layer->B[i];
+		}
+	}
+
+	return 1;
+}
+
+// quantize x to xq in [-128, 127] with x = scale * (xq - zero), for a range
+// which includes 0
+static void quantizeInput(int8_t *xq, NNFloat const *x, int n,
+	NNFloat *scale, int *zero) {
+	NNFloat xMin = 0, xMax = 0;
+	for (int i = 0; i < n; i++) {
+		if (x[i] < xMin) {
+			xMin = x[i];
+		} else if (x[i] > xMax) {
+			xMax = x[i];
+		}
+	}
+	*scale = xMax > xMin ? (xMax - xMin) / 255 : 1;
+	*zero = (int)lrint(-128 - xMin / *scale);
+	*zero = *zero < -128 ? -128 : *zero > 127 ? 127 : *zero;
+	for (int i = 0; i < n; i++) {
+		long q = lrint(x[i] / *scale) + *zero;
+		xq[i] = q < -128 ? -128 : q > 127 ? 127 : (int8_t)q;
+	}
+}
+
+void NNQuantEval(NNQuant *qnn) {
+	for (int k = 0; k < qnn->layerCount; k++) {
+		NNQuantLayer *layer = &qnn->layer[k];
+		NNFloat const *input = k == 0 ? qnn->input : qnn->layer[k - 1].output;
+		NNFloat xScale;
+		int xZero;
+		quantizeInput(qnn->inputQ, input, layer->inputCount, &xScale, &xZero);
+		NNFloat scale = layer->wScale * xScale;
+		for (int i = 0; i < layer->outputCount; i++) {
+			int32_t s = qnn->dot(&layer->W[i * layer->inputCount], qnn->inputQ,
+				layer->inputCount) - xZero * layer->rowSum[i];
+			layer->output[i] = layer->B[i] + scale * s;
+		}
+		qnn->kernels->activate(layer->output, layer->output, layer->outputCount,
+			layer->activation, qnn->accuracy);
+	}
+}
+
+NNFloat *NNQuantGetInputPtr(NNQuant const *qnn) {
+	return qnn->input;
+}
+
+NNFloat *NNQuantGetOutputPtr(NNQuant const *qnn) {
+	return qnn->layer[qnn->layerCount - 1].output;
+}
+
+int NNQuantWeightMemorySize(NNQuant const *qnn) {
+	int size = 0;
+	for (int k = 0; k < qnn->layerCount; k++) {
+		size += qnn->layer[k].outputCount * qnn->layer[k].inputCount;
+	}
+	return size;
+}
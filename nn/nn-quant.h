@@ -0,0 +1,78 @@
+/*
+	Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+	Miniature Mobile Robots group, Switzerland
+	Author: Yves Piguet
+
+	Licensed under the 3-Clause BSD License;
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+	https://opensource.org/licenses/BSD-3-Clause
+*/
+
+/*
+Int8 version of a trained neural network, for compact storage and faster
+inference. Weights of each layer are quantized symmetrically to int8 with a
+float scale (W = wScale * Wq). Inputs of each layer are quantized when the
+network is evaluated, with a scale and a zero point calculated from their
+range (x = xScale * (xq - xZero)); dot products are computed with int8 x
+int8 -> int32 kernels, and offsets, activation functions and outputs are
+float.
+*/
+
+#ifndef __NN_QUANT_H
+#define __NN_QUANT_H
+
+#include "nn.h"
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct {
+	int inputCount;
+	int outputCount;
+	NNActivation activation;
+	NNFloat wScale;	// scale of W
+	int8_t *W;	// W[i * inputCount + j] between input j and output i
+	int32_t *rowSum;	// rowSum[i] = sum of W[i * inputCount + j] for all j
+	NNFloat *B;
+	NNFloat *output;
+} NNQuantLayer;
+
+typedef struct {
+	int layerCount;
+	int inputCount;
+	int outputCount;
+	NNAccuracy accuracy;
+	NNKernels const *kernels;	// for activation functions
+	int32_t (*dot)(int8_t const *a, int8_t const *b, int n);
+	NNFloat *input;
+	int8_t *inputQ;	// quantized input of the current layer
+	NNQuantLayer *layer;
+} NNQuant;
+
+// calculate amount of memory (in bytes) required for int8 version of nn
+int NNQuantMemorySize(NN const *nn);
+
+// convert nn to int8 in mem (NNQuantMemorySize(nn) bytes) (dense layers
+// only), returning 1 for success or 0 for failure
+int NNQuantConvert(NNQuant *qnn, NN const *nn, void *mem);
+
+// evaluate output of each layer from first to last
+void NNQuantEval(NNQuant *qnn);
+
+// get address of inputs
+NNFloat *NNQuantGetInputPtr(NNQuant const *qnn);
+
+// get address of outputs of last layer
+NNFloat *NNQuantGetOutputPtr(NNQuant const *qnn);
+
+// number of bytes used by the weights of qnn
+int NNQuantWeightMemorySize(NNQuant const *qnn);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,324 @@
+/*
+	Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+	Miniature Mobile Robots group, Switzerland
+	Author: Yves Piguet
+
+	Licensed under the 3-Clause BSD License;
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+	https://opensource.org/licenses/BSD-3-Clause
+*/
+
+/*
+Neural network with a topology fixed at compile time (C++17, header only).
+StaticNN<2, Layer<3, Tanh>, Layer<1, Tanh>> has 2 inputs, a hidden layer of
+3 tanh neurons and an output layer of 1 tanh neuron. Layer sizes and
+activation functions are template parameters: weights, offsets and outputs
+are stored in std::array members without allocation, memorySize is the
+exact footprint as a constexpr, and loops over layers, outputs and inputs
+are unrolled by the compiler, without runtime sizes or activation switch.
+Since code size grows with the number of weights, it is meant for the small
+networks of the robot.
+
+Weights and offsets can be loaded from and saved to a dense NN with the same
+topology, for instance to train with NNBackProp and evaluate with StaticNN
+or the opposite. Activation functions are computed with tanh from libm
+(NNAccuracyExact).
+*/
+
+#ifndef __NN_STATIC_H
+#define __NN_STATIC_H
+
+#include "nn.h"
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+namespace nnstatic {
+
+constexpr NNActivation Identity = NNActivationIdentity;
+constexpr NNActivation Tanh = NNActivationTanh;
+constexpr NNActivation Sigmoid = NNActivationSigmoid;
+
+// layer of N outputs with activation function A
+template <int N, NNActivation A = Tanh>
+struct Layer {
+	static_assert(N > 0, "layer without output");
+	static constexpr int outputCount = N;
+	static constexpr NNActivation activation = A;
+};
+
+namespace detail {
+
+// call f(std::integral_constant<int, I>()) for I in the sequence
+template <typename F, int... I>
+inline void unroll(F const &f, std::integer_sequence<int, I...>) {
+	(f(std::integral_constant<int, I>()), ...);
+}
+
+// call f for 0, ..., N-1, with the index as a compile-time constant
+template <int N, typename F>
+inline void unroll(F const &f) {
+	unroll(f, std::make_integer_sequence<int, N>());
+}
+
+// sizes of layers: size[0] inputs and size[k+1] outputs in layer k
+template <int... S>
+struct Topology {
+	static constexpr int layerCount = sizeof...(S) - 1;
+	static constexpr int size[] = {S...};
+
+	// offset of W of layer k in weights and offsets (W then B for each layer)
+	static constexpr int paramOffset(int k) {
+		int n = 0;
+		for (int l = 0; l < k; l++) {
+			n += size[l] * size[l + 1] + size[l + 1];
+		}
+		return n;
+	}
+
+	// offset of input of layer k (output of layer k-1) in nodes
+	static constexpr int nodeOffset(int k) {
+		int n = 0;
+		for (int l = 0; l < k; l++) {
+			n += size[l];
+		}
+		return n;
+	}
+
+	static constexpr int maxSize() {
+		int n = 0;
+		for (int l = 0; l <= layerCount; l++) {
+			n = size[l] > n ? size[l] : n;
+		}
+		return n;
+	}
+};
+
+template <NNActivation A>
+inline NNFloat activate(NNFloat p) {
+	if constexpr (A == NNActivationTanh) {
+		return std::tanh(p);
+	} else if constexpr (A == NNActivationSigmoid) {
+		return (1 + std::tanh(p / 2)) / 2;
+	} else {
+		return p;
+	}
+}
+
+// derivative of activation function calculated from its output y
+template <NNActivation A>
+inline NNFloat derivative(NNFloat y) {
+	if constexpr (A == NNActivationTanh) {
+		return 1 - y * y;
+	} else if constexpr (A == NNActivationSigmoid) {
+		return y * (1 - y);
+	} else {
+		return 1;
+	}
+}
+
+}	// namespace detail
+
+template <int Inputs, typename... Layers>
+class StaticNN {
+	using Topo = detail::Topology<Inputs, Layers::outputCount...>;
+	template <int K>
+	using LayerType = std::tuple_element_t<K, std::tuple<Layers...>>;
+
+public:
+	static_assert(sizeof...(Layers) > 0, "network without layer");
+	static_assert(Inputs > 0, "network without input");
+
+	static constexpr int layerCount = Topo::layerCount;
+	static constexpr int inputCount = Inputs;
+	static constexpr int outputCount = Topo::size[layerCount];
+	// number of weights and offsets
+	static constexpr int paramCount = Topo::paramOffset(layerCount);
+	// number of inputs and outputs of all layers
+	static constexpr int nodeCount = Topo::nodeOffset(layerCount + 1);
+	// size of StaticNN in bytes
+	static constexpr std::size_t memorySize
+		= (paramCount + nodeCount) * sizeof(NNFloat);
+
+	// temporary data and gradients for backprop
+	struct BackProp {
+		std::array<NNFloat, paramCount> gradient;	// same layout as weights
+		std::array<NNFloat, Topo::maxSize()> E;	// error of current layer
+		std::array<NNFloat, Topo::maxSize()> D;	// E multiplied by phi'
+		// size of BackProp in bytes
+		static constexpr std::size_t memorySize
+			= (paramCount + 2 * Topo::maxSize()) * sizeof(NNFloat);
+	};
+
+	NNFloat *input() {
+		return node.data();
+	}
+
+	NNFloat const *output() const {
+		return node.data() + Topo::nodeOffset(layerCount);
+	}
+
+	// W[i * inputCount + j] between input j and output i of layer k
+	template <int K>
+	NNFloat *W() {
+		return param.data() + Topo::paramOffset(K);
+	}
+
+	template <int K>
+	NNFloat *B() {
+		return param.data() + Topo::paramOffset(K) + Topo::size[K] * Topo::size[K + 1];
+	}
+
+	void clearWeights() {
+		param.fill(0);
+	}
+
+	// evaluate output of each layer from first to last
+	void eval() {
+		detail::unroll<layerCount>([this](auto k) {
+			constexpr int K = decltype(k)::value;
+			constexpr int in = Topo::size[K];
+			constexpr int out = Topo::size[K + 1];
+			constexpr NNActivation A = LayerType<K>::activation;
+			NNFloat const *x = node.data() + Topo::nodeOffset(K);
+			NNFloat *y = node.data() + Topo::nodeOffset(K + 1);
+			NNFloat const *W = param.data() + Topo::paramOffset(K);
+			NNFloat const *B = W + in * out;
+			detail::unroll<out>([&](auto i) {
+				NNFloat p = B[i];
+				detail::unroll<in>([&](auto j) {
+					p += W[i * in + j] * x[j];
+				});
+				y[i] = detail::activate<A>(p);
+			});
+		});
+	}
+
+	// cost function for back propagation after eval()
+	NNFloat cost(NNFloat const *expected) const {
+		NNFloat const *y = output();
+		NNFloat sumErr2 = 0;
+		for (int i = 0; i < outputCount; i++) {
+			sumErr2 += (expected[i] - y[i]) * (expected[i] - y[i]);
+		}
+		return sumErr2 / 2;
+	}
+
+	static void resetGradients(BackProp &bp) {
+		bp.gradient.fill(0);
+	}
+
+	// add to the gradient of bp the gradient for the expected output of the
+	// input, when eval() has already been called for it (same as
+	// NNBackPropAddGradientsAfterEval)
+	void addGradients(BackProp &bp, NNFloat const *expected) const {
+		NNFloat const *yLast = output();
+		for (int i = 0; i < outputCount; i++) {
+			bp.E[i] = expected[i] - yLast[i];
+		}
+		detail::unroll<layerCount>([&](auto r) {
+			constexpr int K = layerCount - 1 - decltype(r)::value;
+			constexpr int in = Topo::size[K];
+			constexpr int out = Topo::size[K + 1];
+			constexpr NNActivation A = LayerType<K>::activation;
+			NNFloat const *x = node.data() + Topo::nodeOffset(K);
+			NNFloat const *y = node.data() + Topo::nodeOffset(K + 1);
+			NNFloat const *W = param.data() + Topo::paramOffset(K);
+			NNFloat *Wg = bp.gradient.data() + Topo::paramOffset(K);
+			NNFloat *Bg = Wg + in * out;
+			detail::unroll<out>([&](auto i) {
+				bp.D[i] = bp.E[i] * detail::derivative<A>(y[i]);
+				Bg[i] += bp.D[i];
+				detail::unroll<in>([&](auto j) {
+					Wg[i * in + j] += bp.D[i] * x[j];
+				});
+			});
+			if constexpr (K > 0) {
+				// E := W' * D
+				detail::unroll<in>([&](auto j) {
+					NNFloat e = 0;
+					detail::unroll<out>([&](auto i) {
+						e += W[i * in + j] * bp.D[i];
+					});
+					bp.E[j] = e;
+				});
+			}
+		});
+	}
+
+	// apply one step of back propagation (gradient descent)
+	void apply(BackProp const &bp, NNFloat eta) {
+		for (int i = 0; i < paramCount; i++) {
+			param[i] += eta * bp.gradient[i];
+		}
+	}
+
+	// copy weights and offsets from nn, returning true for success or false
+	// if its topology is different
+	bool load(NN const *nn) {
+		if (!sameTopology(nn)) {
+			return false;
+		}
+		for (int k = 0; k < layerCount; k++) {
+			NNLayer const *layer = &nn->layer[k];
+			int n = layer->inputCount * layer->outputCount;
+			NNFloat *W = param.data() + Topo::paramOffset(k);
+			for (int i = 0; i < n; i++) {
+				W[i] = layer->W[i];
+			}
+			for (int i = 0; i < layer->outputCount; i++) {
+				W[n + i] = layer->B[i];
+			}
+		}
+		return true;
+	}
+
+	// copy weights and offsets to nn, returning true for success or false if
+	// its topology is different or it has external layers
+	bool save(NN *nn) const {
+		if (!sameTopology(nn) || NNHasExternalLayer(nn)) {
+			return false;
+		}
+		for (int k = 0; k < layerCount; k++) {
+			NNLayer *layer = &nn->layer[k];
+			int n = layer->inputCount * layer->outputCount;
+			NNFloat const *W = param.data() + Topo::paramOffset(k);
+			for (int i = 0; i < n; i++) {
+				layer->W[i] = W[i];
+			}
+			for (int i = 0; i < layer->outputCount; i++) {
+				layer->B[i] = W[n + i];
+			}
+		}
+		return true;
+	}
+
+	// check if nn has the same sizes and activation functions with dense
+	// layers
+	static bool sameTopology(NN const *nn) {
+		static constexpr NNActivation activation[] = {Layers::activation...};
+		if (nn->layerCount != layerCount) {
+			return false;
+		}
+		for (int k = 0; k < layerCount; k++) {
+			if (nn->layer[k].inputCount != Topo::size[k]
+				|| nn->layer[k].outputCount != Topo::size[k + 1]
+				|| nn->layer[k].activation != activation[k]
+				|| !nn->layer[k].W) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	std::array<NNFloat, paramCount> param;	// W then B for each layer
+	std::array<NNFloat, nodeCount> node;	// input then output of each layer
+};
+
+}	// namespace nnstatic
+
+#endif
@@ -11,17 +11,95 @@
 
 #include "nn.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
+// tile size of the weight matrix in NNEvalBatch
+#define NNBatchBlockOutputs 32
+#define NNBatchBlockInputs 128
+
+// optimizer parameters
+#define NNMomentumDecay 0.9
+#define NNRMSPropDecay 0.9
+#define NNAdamBeta1 0.9
+#define NNAdamBeta2 0.999
+#define NNOptimizerEpsilon 1e-7
+
+// priority added to the priority of each observation for sampling
+#define NNPriorityEpsilon 1e-4
+
+static uint32_t rotl(uint32_t x, int k) {
+	return (x << k) | (x >> (32 - k));
+}
+
+void NNSeed(NN *nn, uint32_t seed) {
+	// state from splitmix64, never all 0
+	uint64_t x = seed;
+	for (int i = 0; i < 4; i += 2) {
+		x += 0x9e3779b97f4a7c15ull;
+		uint64_t z = x;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		z ^= z >> 31;
+		nn->random[i] = (uint32_t)z;
+		nn->random[i + 1] = (uint32_t)(z >> 32);
+	}
+}
+
+uint32_t NNRandom(NN *nn) {
+	uint32_t *s = nn->random;
+	if ((s[0] | s[1] | s[2] | s[3]) == 0) {
+		NNSeed(nn, 0);
+	}
+
+	// xoshiro128**
+	uint32_t r = rotl(s[1] * 5, 7) * 9;
+	uint32_t t = s[1] << 9;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 11);
+	return r;
+}
+
+void NNRandomJump(NN *nn) {
+	static uint32_t const jump[] = {
+		0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b
+	};
+	if ((nn->random[0] | nn->random[1] | nn->random[2] | nn->random[3]) == 0) {
+		NNSeed(nn, 0);
+	}
+	uint32_t s[4] = {0, 0, 0, 0};
+	for (int i = 0; i < 4; i++) {
+		for (int b = 0; b < 32; b++) {
+			if (jump[i] & (uint32_t)1 << b) {
+				for (int j = 0; j < 4; j++) {
+					s[j] ^= nn->random[j];
+				}
+			}
+			NNRandom(nn);
+		}
+	}
+	for (int j = 0; j < 4; j++) {
+		nn->random[j] = s[j];
+	}
+}
+
 // uniform pseudorandom number between - and + amplitude
-static NNFloat prand(NNFloat amplitude) {
-#if defined(__APPLE__)
-	return (int32_t)(arc4random() ^ 0x80000000) * (amplitude / 0x80000000);
-#elif defined(__linux__)
-	return (random() - 0x40000000l) * (amplitude / 0x40000000);
-#else
-	return (rand() - RAND_MAX / 2) * (amplitude / (RAND_MAX / 2));
-#endif
+static NNFloat prand(NN *nn, NNFloat amplitude) {
+	return (int32_t)(NNRandom(nn) ^ 0x80000000) * (amplitude / 0x80000000);
+}
+
+// uniform pseudorandom number in [0, 1)
+static NNFloat urand(NN *nn) {
+	return (NNRandom(nn) >> 8) * (1.0 / 0x1000000);
+}
+
+// uniform pseudorandom integer in [0, n)
+static int irand(NN *nn, int n) {
+	return (int)(((uint64_t)NNRandom(nn) * (uint32_t)n) >> 32);
 }
 
 static void copyFloats(NNFloat *dest, NNFloat const *src, int n) {
@@ -36,20 +114,62 @@ static void resetFloats(NNFloat *dest, int n) {
 	}
 }
 
-static void accumulateFloats(NNFloat *dest, NNFloat *src, int n, NNFloat weight) {
-	for (int i = 0; i < n; i++) {
-		dest[i] += weight * src[i];
+void NNSetAccuracy(NN *nn, NNAccuracy accuracy) {
+	nn->accuracy = accuracy;
+}
+
+void NNSetOptimizer(NN *nn, NNOptimizer optimizer) {
+	nn->optimizer = optimizer;
+}
+
+// number of vectors of optimizer state, each of the size of all the weights
+// and offsets
+static int optimizerStateCount(NNOptimizer optimizer) {
+	switch (optimizer) {
+	case NNOptimizerMomentum:
+	case NNOptimizerRMSProp:
+		return 1;
+	case NNOptimizerAdam:
+		return 2;
+	case NNOptimizerSGD:
+	default:
+		return 0;
 	}
 }
 
-static NNFloat tanhder(NNFloat p) {
-	NNFloat tanhp = tanh(p);
-	return 1 - tanhp * tanhp;
+int NNArenaSize(int layerCount, int const *size) {
+	// layer array, then input, and W, B and output of each layer in order of
+	// evaluation, each aligned (arena itself can be misaligned)
+	int floatCount = NNArenaRound(size[0]);
+	for (int k = 0; k < layerCount; k++) {
+		floatCount += NNArenaRound(size[k] * size[k + 1])
+			+ 2 * NNArenaRound(size[k + 1]);
+	}
+	int layerArraySize = layerCount * sizeof(NNLayer);
+	layerArraySize = (layerArraySize + NNArenaAlignment - 1)
+		& ~(NNArenaAlignment - 1);
+	return NNArenaAlignment - 1 + layerArraySize + floatCount * sizeof(NNFloat);
 }
 
-static NNFloat sigmoidder(NNFloat p) {
-	NNFloat sigmoid = (1 + tanh(p / 2)) / 2;
-	return sigmoid * (1 - sigmoid);
+int NNArenaCopy(NN *dest, NN const *src) {
+	if (!dest->arena || !src->arena
+		|| dest->layerCount != src->layerCount || src->layerCount == 0) {
+		return 0;
+	}
+	for (int k = 0; k < src->layerCount; k++) {
+		if (dest->layer[k].inputCount != src->layer[k].inputCount
+			|| dest->layer[k].outputCount != src->layer[k].outputCount) {
+			return 0;
+		}
+	}
+
+	// from input of first layer to end of output of last layer
+	NNLayer const *layerLast = &src->layer[src->layerCount - 1];
+	NNFloat const *end = layerLast->output + NNArenaRound(layerLast->outputCount);
+	memcpy(dest->layer[0].input, src->layer[0].input,
+		(end - src->layer[0].input) * sizeof(NNFloat));
+
+	return 1;
 }
 
 NNFloat *NNGetInputPtr(NN const *nn) {
@@ -64,8 +184,14 @@ NNFloat *NNGetOutputPtr(NN const *nn) {
 
 void NNClearWeights(NN *nn) {
 	for (int k = 0; k < nn->layerCount; k++) {
-		for (int i = 0; i < nn->layer[k].inputCount * nn->layer[k].outputCount; i++) {
-			nn->layer[k].W[i] = 0;
+		if (nn->layer[k].external) {
+			continue;
+		}
+		if (nn->layer[k].W) {
+			resetFloats(nn->layer[k].W,
+				nn->layer[k].inputCount * nn->layer[k].outputCount);
+		} else {
+			resetFloats(nn->layer[k].Ws, nn->layer[k].nonZeroCount);
 		}
 		for (int i = 0; i < nn->layer[k].outputCount; i++) {
 			nn->layer[k].B[i] = 0;
@@ -75,9 +201,16 @@ void NNClearWeights(NN *nn) {
 
 void NNInitWeights(NN *nn) {
 	for (int k = 0; k < nn->layerCount; k++) {
+		if (nn->layer[k].external) {
+			continue;
+		}
 		NNFloat amplitude = 1 / sqrt(nn->layer[k].inputCount);
-		for (int i = 0; i < nn->layer[k].inputCount * nn->layer[k].outputCount; i++) {
-			nn->layer[k].W[i] = prand(amplitude);
+		NNFloat *W = nn->layer[k].W ? nn->layer[k].W : nn->layer[k].Ws;
+		int n = nn->layer[k].W
+			? nn->layer[k].inputCount * nn->layer[k].outputCount
+			: nn->layer[k].nonZeroCount;
+		for (int i = 0; i < n; i++) {
+			W[i] = prand(nn, amplitude);
 		}
 		for (int i = 0; i < nn->layer[k].outputCount; i++) {
 			nn->layer[k].B[i] = 0;
@@ -89,32 +222,190 @@ void NNEval(NN *nn, NNFloat **P) {
 	for (int k = 0; k < nn->layerCount; k++) {
 		NNLayer *layer = &nn->layer[k];
 		NNFloat const *input = k == 0 ? layer->input : nn->layer[k - 1].output;
-		for (int i = 0; i < layer->outputCount; i++) {
-			NNFloat p = layer->B[i];
-			for (int j = 0; j < layer->inputCount; j++) {
-				p += layer->W[i * layer->inputCount + j] * input[j];
+		NNFloat *p = P ? P[k] : layer->output;
+		if (layer->W) {
+			for (int i = 0; i < layer->outputCount; i++) {
+				p[i] = layer->B[i] + layer->kernels->dot(&layer->W[i * layer->inputCount],
+					input, layer->inputCount);
 			}
-			if (P) {
-				P[k][i] = p;
+		} else {
+			for (int i = 0; i < layer->outputCount; i++) {
+				int r = layer->rowStart[i];
+				p[i] = layer->B[i] + layer->kernels->sparseDot(&layer->Ws[r],
+					&layer->column[r], input, layer->rowStart[i + 1] - r);
 			}
-			switch (layer->activation) {
-			case NNActivationTanh:
-				p = tanh(p);
-				break;
-			case NNActivationSigmoid:
-				p = (1 + tanh(p / 2)) / 2;
-				break;
-			case NNActivationIdentity:
-			default:
-				break;
+		}
+		layer->kernels->activate(layer->output, p, layer->outputCount,
+			layer->activation, nn->accuracy);
+	}
+}
+
+int NNEvalBatchTempMemorySize(NN *nn, int batchCount) {
+	// one matrix of size batchCount-by-outputCount per hidden layer
+	int dataSize = 0;
+	for (int k = 0; k < nn->layerCount - 1; k++) {
+		dataSize += batchCount * nn->layer[k].outputCount;
+	}
+
+	return nn->layerCount * sizeof(NNFloat *) + dataSize * sizeof(NNFloat);
+}
+
+NNFloat **NNEvalBatchInit(NN *nn, int batchCount, void *tempMem) {
+	NNFloat **Y = (NNFloat **)tempMem;
+	NNFloat *data = (NNFloat *)(Y + nn->layerCount);
+
+	int offset = 0;
+	for (int k = 0; k < nn->layerCount - 1; k++) {
+		Y[k] = &data[offset];
+		offset += batchCount * nn->layer[k].outputCount;
+	}
+	Y[nn->layerCount - 1] = NULL;	// last layer stored in outputs
+
+	return Y;
+}
+
+void NNEvalBatch(NN *nn,
+	NNFloat const *inputs, int inputStride, int batchCount,
+	NNFloat *outputs, int outputStride, NNFloat **Y) {
+	for (int k = 0; k < nn->layerCount; k++) {
+		NNLayer *layer = &nn->layer[k];
+		NNFloat const *X = k == 0 ? inputs : Y[k - 1];
+		int xStride = k == 0 ? inputStride : layer->inputCount;
+		NNFloat *Z = k == nn->layerCount - 1 ? outputs : Y[k];
+		int zStride = k == nn->layerCount - 1 ? outputStride : layer->outputCount;
+
+		// Z := B
+		for (int b = 0; b < batchCount; b++) {
+			copyFloats(&Z[b * zStride], layer->B, layer->outputCount);
+		}
+
+		if (layer->W) {
+			// Z := Z + X * W', by tiles of W small enough to stay in cache
+			// while the whole batch goes through them; with more than
+			// NNBatchBlockInputs inputs, sums are split in partial dot
+			// products, whose rounding can differ slightly from NNEval
+			for (int i0 = 0; i0 < layer->outputCount; i0 += NNBatchBlockOutputs) {
+				int i1 = i0 + NNBatchBlockOutputs < layer->outputCount
+					? i0 + NNBatchBlockOutputs : layer->outputCount;
+				for (int j0 = 0; j0 < layer->inputCount; j0 += NNBatchBlockInputs) {
+					int j1 = j0 + NNBatchBlockInputs < layer->inputCount
+						? j0 + NNBatchBlockInputs : layer->inputCount;
+					for (int b = 0; b < batchCount; b++) {
+						NNFloat const *x = &X[b * xStride];
+						NNFloat *z = &Z[b * zStride];
+						for (int i = i0; i < i1; i++) {
+							z[i] += layer->kernels->dot(&layer->W[i * layer->inputCount + j0],
+								&x[j0], j1 - j0);
+						}
+					}
+				}
+			}
+		} else {
+			// Z := Z + X * W' for a sparse layer, row by row
+			for (int b = 0; b < batchCount; b++) {
+				NNFloat const *x = &X[b * xStride];
+				NNFloat *z = &Z[b * zStride];
+				for (int i = 0; i < layer->outputCount; i++) {
+					int r = layer->rowStart[i];
+					z[i] += layer->kernels->sparseDot(&layer->Ws[r],
+						&layer->column[r], x, layer->rowStart[i + 1] - r);
+				}
+			}
+		}
+
+		// activation
+		for (int b = 0; b < batchCount; b++) {
+			layer->kernels->activate(&Z[b * zStride], &Z[b * zStride],
+				layer->outputCount, layer->activation, nn->accuracy);
+		}
+	}
+}
+
+int NNPrune(NN *nn, NNFloat threshold) {
+	int count = 0;
+	for (int k = 0; k < nn->layerCount; k++) {
+		NNLayer *layer = &nn->layer[k];
+		for (int i = 0; layer->W && !layer->external
+			&& i < layer->outputCount * layer->inputCount; i++) {
+			if (fabs(layer->W[i]) < threshold) {
+				layer->W[i] = 0;
+			}
+		}
+		count += NNLayerNonZeroCount(layer);
+	}
+	return count;
+}
+
+int NNLayerNonZeroCount(NNLayer const *layer) {
+	NNFloat const *W = layer->W ? layer->W : layer->Ws;
+	int n = layer->W ? layer->outputCount * layer->inputCount : layer->nonZeroCount;
+	int count = 0;
+	for (int i = 0; i < n; i++) {
+		if (W[i] != 0) {
+			count++;
+		}
+	}
+	return count;
+}
+
+int NNSparseSetWeights(NNLayer *layer, NNFloat const *W) {
+	int r = 0;
+	for (int i = 0; i < layer->outputCount; i++) {
+		layer->rowStart[i] = r;
+		for (int j = 0; j < layer->inputCount; j++) {
+			if (W[i * layer->inputCount + j] != 0) {
+				if (r >= layer->nonZeroCount) {
+					return 0;
+				}
+				layer->column[r] = j;
+				layer->Ws[r++] = W[i * layer->inputCount + j];
 			}
-			layer->output[i] = p;
 		}
 	}
+	// unused capacity as zero weights at the end of the last row
+	for (; r < layer->nonZeroCount; r++) {
+		layer->column[r] = 0;
+		layer->Ws[r] = 0;
+	}
+	layer->rowStart[layer->outputCount] = r;
+	return 1;
+}
+
+int NNHasSparseLayer(NN const *nn) {
+	for (int k = 0; k < nn->layerCount; k++) {
+		if (!nn->layer[k].W) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int NNHasExternalLayer(NN const *nn) {
+	for (int k = 0; k < nn->layerCount; k++) {
+		if (nn->layer[k].external) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int NNWeightMemorySize(NN const *nn) {
+	int size = 0;
+	for (int k = 0; k < nn->layerCount; k++) {
+		NNLayer const *layer = &nn->layer[k];
+		size += layer->W
+			? layer->outputCount * layer->inputCount * sizeof(NNFloat)
+			: layer->nonZeroCount * (sizeof(NNFloat) + sizeof(int))
+				+ (layer->outputCount + 1) * sizeof(int);
+	}
+	return size;
 }
 
 void NNHebbianRuleStep(NN *nn, int layerIndex, NNFloat alpha) {
 	NNLayer *layer = &nn->layer[layerIndex];
+	if (layer->external) {
+		return;
+	}
 	for (int i = 0; i < layer->outputCount; i++) {
 		for (int j = 0; j < layer->inputCount; j++) {
 			layer->W[i * layer->inputCount + j]
@@ -140,44 +431,65 @@ int NNBackPropTempMemorySize(NN *nn) {
 		if (nn->layer[k].outputCount > maxOutputCount) {
 			maxOutputCount = nn->layer[k].outputCount;
 		}
-		dataSize += nn->layer[k].outputCount * (2 + nn->layer[k].inputCount);
+		dataSize += nn->layer[k].outputCount
+			* (1 + nn->layer[k].inputCount
+				+ optimizerStateCount(nn->optimizer) * (1 + nn->layer[k].inputCount));
 	}
-	dataSize += maxOutputCount;
+	dataSize += 2 * maxOutputCount;
 
-	return 3 * nn->layerCount * sizeof(NNFloat *) + dataSize * sizeof(NNFloat);
+	return 4 * nn->layerCount * sizeof(NNFloat *) + dataSize * sizeof(NNFloat);
 }
 
 int NNBackPropInit(NN *nn, NNBackProp *bp, void *tempMem) {
 	// E: one vector of size max(outputCount)
-	// P: one vector of size outputCount per layer
+	// D: one vector of size max(outputCount)
 	// Wg: one matrix of size outputCount-by-inputCount (same as W) per layer
 	// Bg: one vector of size outputCount per layer
+	// M, S: optimizer state of size outputCount*(1+inputCount) per layer, if
+	// required by the optimizer
+	if (NNHasExternalLayer(nn) || NNHasSparseLayer(nn)) {
+		return 0;
+	}
+
 	int maxOutputCount = 0;
-	int dataSize = 0;
 	for (int k = 0; k < nn->layerCount; k++) {
 		if (nn->layer[k].outputCount > maxOutputCount) {
 			maxOutputCount = nn->layer[k].outputCount;
 		}
-		dataSize += nn->layer[k].outputCount * (2 + nn->layer[k].inputCount);
 	}
-	dataSize += maxOutputCount;
 
 	bp->ptr = (NNFloat **)tempMem;
-	bp->data = (NNFloat *)(bp->ptr + 3 * nn->layerCount);
+	bp->data = (NNFloat *)(bp->ptr + 4 * nn->layerCount);
 
 	bp->E = bp->data;
-	bp->P = bp->ptr;
-	bp->Bg = bp->ptr + nn->layerCount;
-	bp->Wg = bp->ptr + 2 * nn->layerCount;
-	int offset = maxOutputCount;
+	bp->D = bp->data + maxOutputCount;
+	bp->Bg = bp->ptr;
+	bp->Wg = bp->ptr + nn->layerCount;
+	bp->M = bp->ptr + 2 * nn->layerCount;
+	bp->S = bp->ptr + 3 * nn->layerCount;
+	int stateCount = optimizerStateCount(nn->optimizer);
+	int offset = 2 * maxOutputCount;
 	for (int k = 0; k < nn->layerCount; k++) {
-		bp->P[k] = &bp->data[offset];
-		offset += nn->layer[k].outputCount;
+		int paramCount = nn->layer[k].outputCount * (1 + nn->layer[k].inputCount);
 		bp->Bg[k] = &bp->data[offset];
 		offset += nn->layer[k].outputCount;
 		bp->Wg[k] = &bp->data[offset];
 		offset += nn->layer[k].outputCount * nn->layer[k].inputCount;
+		bp->M[k] = NULL;
+		bp->S[k] = NULL;
+		if (stateCount >= 1) {
+			bp->M[k] = &bp->data[offset];
+			resetFloats(bp->M[k], paramCount);
+			offset += paramCount;
+		}
+		if (stateCount >= 2) {
+			bp->S[k] = &bp->data[offset];
+			resetFloats(bp->S[k], paramCount);
+			offset += paramCount;
+		}
 	}
+	bp->optimizer = nn->optimizer;
+	bp->t = 0;
 
 	NNBackPropResetGradients(nn, bp);
 
@@ -197,68 +509,274 @@ void NNBackPropAddGradients(NN *nn, NNBackProp *bp) {
 		nn->layer[nn->layerCount - 1].outputCount);
 
 	// feedforward
-	NNEval(nn, bp->P);
+	NNEval(nn, NULL);
 
+	NNBackPropAddGradientsAfterEval(nn, bp, bp->E);
+}
+
+void NNBackPropAddGradientsAfterEval(NN *nn, NNBackProp *bp,
+	NNFloat const *output) {
 	// error of last layer (column vector)
 	// beware of the sign: E = Yobs - Y, W and B should be corrected by
 	// adding gradients with a positive gain eta
-	accumulateFloats(bp->E, nn->layer[nn->layerCount - 1].output,
-		nn->layer[nn->layerCount - 1].outputCount, -1);
+	NNLayer *layerLast = &nn->layer[nn->layerCount - 1];
+	for (int i = 0; i < layerLast->outputCount; i++) {
+		bp->E[i] = output[i] - layerLast->output[i];
+	}
 
 	// backprop
 	for (int k = nn->layerCount - 1; k >= 0; k--) {
 		NNLayer *layer = &nn->layer[k];
 
-		// Bg = E .* phi'(P)
+		// D = E .* phi'(P), with phi'(P) calculated from Y = phi(P)
 		// (column vector, length outputCount)
 		switch (layer->activation) {
 		case NNActivationTanh:
+			// tanh' = 1 - tanh^2
 			for (int i = 0; i < layer->outputCount; i++) {
-				bp->Bg[k][i] = bp->E[i] * tanhder(bp->P[k][i]);
+				bp->D[i] = bp->E[i] * (1 - layer->output[i] * layer->output[i]);
 			}
 			break;
 		case NNActivationSigmoid:
+			// sigmoid' = sigmoid (1 - sigmoid)
 			for (int i = 0; i < layer->outputCount; i++) {
-				bp->Bg[k][i] = bp->E[i] * sigmoidder(bp->P[k][i]);
+				bp->D[i] = bp->E[i] * layer->output[i] * (1 - layer->output[i]);
 			}
 			break;
 		case NNActivationIdentity:
 		default:
 			// phi' = 1
-			for (int i = 0; i < layer->outputCount; i++) {
-				bp->Bg[k][i] = bp->E[i];
-			}
+			copyFloats(bp->D, bp->E, layer->outputCount);
 			break;
 		}
 
-		// Wg = Bg * U'
+		// Bg += D
+		layer->kernels->axpy(bp->Bg[k], bp->D, layer->outputCount, 1);
+
+		// Wg += D * U'
 		// (matrix, same size as W: outputCount rows, inputCount columns)
 		NNFloat const *input = k == 0 ? layer->input : nn->layer[k - 1].output;
 		for (int i = 0; i < layer->outputCount; i++) {
-			for (int j = 0; j < layer->inputCount; j++) {
-				bp->Wg[k][i * layer->inputCount + j] = bp->Bg[k][i] * input[j];
-			}
+			layer->kernels->axpy(&bp->Wg[k][i * layer->inputCount],
+				input, layer->inputCount, bp->D[i]);
 		}
 
 		if (k > 0) {
-			// E := W' * Bg
+			// E := W' * D
 			// (column vector, length inputCount = outputCount of previous layer)
-			for (int i = 0; i < layer->inputCount; i++) {
-				bp->E[i] = 0;
-				for (int j = 0; j < layer->outputCount; j++) {
-					bp->E[i] += layer->W[j * layer->inputCount + i] * bp->Bg[k][j];
-				}
+			// as a sum of rows of W weighted by D, so that W is read
+			// sequentially
+			resetFloats(bp->E, layer->inputCount);
+			for (int j = 0; j < layer->outputCount; j++) {
+				layer->kernels->axpy(bp->E, &layer->W[j * layer->inputCount],
+					layer->inputCount, bp->D[j]);
 			}
 		}
 	}
 }
 
+// update n parameters x with gradient g and optimizer state m and s
+// (eta includes the bias correction of Adam)
+static void optimizerStep(NNOptimizer optimizer, NNKernels const *kernels,
+	NNFloat *x, NNFloat const *g, NNFloat *m, NNFloat *s, int n, NNFloat eta) {
+	switch (optimizer) {
+	case NNOptimizerMomentum:
+		for (int i = 0; i < n; i++) {
+			m[i] = NNMomentumDecay * m[i] + g[i];
+		}
+		kernels->axpy(x, m, n, eta);
+		break;
+	case NNOptimizerRMSProp:
+		for (int i = 0; i < n; i++) {
+			m[i] = NNRMSPropDecay * m[i] + (1 - NNRMSPropDecay) * g[i] * g[i];
+			x[i] += eta * g[i] / (sqrt(m[i]) + NNOptimizerEpsilon);
+		}
+		break;
+	case NNOptimizerAdam:
+		for (int i = 0; i < n; i++) {
+			m[i] = NNAdamBeta1 * m[i] + (1 - NNAdamBeta1) * g[i];
+			s[i] = NNAdamBeta2 * s[i] + (1 - NNAdamBeta2) * g[i] * g[i];
+			x[i] += eta * m[i] / (sqrt(s[i]) + NNOptimizerEpsilon);
+		}
+		break;
+	case NNOptimizerSGD:
+	default:
+		kernels->axpy(x, g, n, eta);
+		break;
+	}
+}
+
 void NNBackPropApply(NN *nn, NNBackProp *bp, NNFloat eta) {
+	bp->t++;
+	if (bp->optimizer == NNOptimizerAdam) {
+		// bias correction of both moments
+		eta *= sqrt(1 - pow(NNAdamBeta2, bp->t)) / (1 - pow(NNAdamBeta1, bp->t));
+	}
+
 	for (int k = 0; k < nn->layerCount; k++) {
-		accumulateFloats(nn->layer[k].B, bp->Bg[k],
-			nn->layer[k].outputCount, eta);
-		accumulateFloats(nn->layer[k].W, bp->Wg[k],
-			nn->layer[k].outputCount * nn->layer[k].inputCount, eta);
+		NNLayer *layer = &nn->layer[k];
+		int outputCount = layer->outputCount;
+		if (layer->external) {
+			continue;
+		}
+		optimizerStep(bp->optimizer, layer->kernels,
+			layer->B, bp->Bg[k],
+			bp->M[k], bp->S[k],
+			outputCount, eta);
+		optimizerStep(bp->optimizer, layer->kernels,
+			layer->W, bp->Wg[k],
+			bp->M[k] ? bp->M[k] + outputCount : NULL,
+			bp->S[k] ? bp->S[k] + outputCount : NULL,
+			outputCount * layer->inputCount, eta);
+	}
+}
+
+void NNBackPropBatch(NN *nn, NNBackProp *bp, NNObservations *obs,
+	int first, int count, NNFloat eta) {
+	NNFloat *nnInput = NNGetInputPtr(nn);
+
+	NNBackPropResetGradients(nn, bp);
+	for (int i = 0; i < count; i++) {
+		NNFloat *input, *output;
+		NNObservationGetPtr(obs, (first + i) % obs->count, &input, &output);
+		copyFloats(nnInput, input, nn->inputCount);
+		NNEval(nn, NULL);
+		NNBackPropAddGradientsAfterEval(nn, bp, output);
+	}
+	NNBackPropApply(nn, bp, eta / count);
+}
+
+void NNTrainingStart(NNTraining *training, NNObservations *obs,
+	int iterCount, int batchSize, NNFloat eta, NNSampling sampling) {
+	training->obs = obs;
+	training->eta = eta;
+	training->sampling = sampling;
+	training->batchSize = batchSize > 0 ? batchSize : 1;
+	training->count = iterCount > 0 ? iterCount * obs->count : 0;
+	training->done = 0;
+	training->batchDone = 0;
+	training->costSum = 0;
+	training->cost = -1;
+}
+
+int NNTrainingStep(NN *nn, NNBackProp *bp, NNTraining *training, int maxSteps) {
+	NNObservations *obs = training->obs;
+	NNFloat *nnInput = NNGetInputPtr(nn);
+
+	if (obs->count == 0) {
+		// observations have been removed
+		training->count = training->done;
+	}
+	for (int n = 0; n < maxSteps && training->done < training->count; n++) {
+		// position in the current pass and index of observation
+		int pos = training->done % obs->count;
+		if (pos == 0 && training->sampling == NNSamplingShuffle) {
+			NNObservationsShuffle(nn, obs);
+		}
+		int i = training->sampling == NNSamplingSweep
+			|| training->sampling == NNSamplingShuffle ? pos
+			: NNObservationsSample(nn, obs, training->sampling);
+		NNFloat *input, *output;
+		NNObservationGetPtr(obs, i, &input, &output);
+		copyFloats(nnInput, input, nn->inputCount);
+		NNEval(nn, NULL);
+		NNFloat cost = NNBackPropCost(nn, output);
+		training->costSum += cost;
+		obs->priority[i] = cost;
+		if (training->batchDone == 0) {
+			NNBackPropResetGradients(nn, bp);
+		}
+		NNBackPropAddGradientsAfterEval(nn, bp, output);
+		training->batchDone++;
+		training->done++;
+
+		// apply at end of batch, pass or training
+		if (training->batchDone >= training->batchSize || pos + 1 == obs->count
+			|| training->done == training->count) {
+			NNBackPropApply(nn, bp, training->eta / training->batchDone);
+			training->batchDone = 0;
+		}
+		if (pos + 1 == obs->count) {
+			training->cost = training->costSum / obs->count;
+			training->costSum = 0;
+		}
+	}
+
+	return training->count - training->done;
+}
+
+int NNObservationsAdd(NNObservations *obs,
+	NNFloat const *input, NNFloat const *output) {
+	int i;
+	if (obs->count < obs->maxCount) {
+		i = obs->count++;
+	} else if (obs->ring && obs->maxCount > 0) {
+		// replace oldest observation
+		i = obs->next;
+		obs->next = (obs->next + 1) % obs->maxCount;
+	} else {
+		return -1;
+	}
+
+	NNFloat *obsInput, *obsOutput;
+	NNObservationGetPtr(obs, i, &obsInput, &obsOutput);
+	if (input) {
+		copyFloats(obsInput, input, obs->inputCount);
+	}
+	if (output) {
+		copyFloats(obsOutput, output, obs->outputCount);
+	}
+
+	// new observations are likely to be sampled soon
+	NNFloat priorityMax = 0;
+	for (int j = 0; j < obs->count; j++) {
+		if (j != i && obs->priority[j] > priorityMax) {
+			priorityMax = obs->priority[j];
+		}
+	}
+	obs->priority[i] = priorityMax > 0 ? priorityMax : 1;
+
+	return i;
+}
+
+int NNObservationsSample(NN *nn, NNObservations const *obs, NNSampling sampling) {
+	if (obs->count == 0) {
+		return -1;
+	}
+	if (sampling != NNSamplingPriority) {
+		return irand(nn, obs->count);
+	}
+
+	// observations with a cost of 0 can still be chosen
+	NNFloat sum = 0;
+	for (int i = 0; i < obs->count; i++) {
+		sum += obs->priority[i] + NNPriorityEpsilon;
+	}
+	NNFloat r = urand(nn) * sum;
+	for (int i = 0; i < obs->count - 1; i++) {
+		r -= obs->priority[i] + NNPriorityEpsilon;
+		if (r < 0) {
+			return i;
+		}
+	}
+	return obs->count - 1;
+}
+
+void NNObservationsShuffle(NN *nn, NNObservations *obs) {
+	int n = obs->inputCount + obs->outputCount;
+	// Fisher-Yates
+	for (int i = obs->count - 1; i > 0; i--) {
+		int j = irand(nn, i + 1);
+		NNFloat *a = &obs->data[i * n];
+		NNFloat *b = &obs->data[j * n];
+		for (int k = 0; k < n; k++) {
+			NNFloat tmp = a[k];
+			a[k] = b[k];
+			b[k] = tmp;
+		}
+		NNFloat tmp = obs->priority[i];
+		obs->priority[i] = obs->priority[j];
+		obs->priority[j] = tmp;
 	}
 }
 
@@ -12,27 +12,83 @@
 #ifndef __NN_H
 #define __NN_H
 
+#include <stdint.h>
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
 
 typedef float NNFloat;
 
+// alignment (bytes) of the buffers of a network allocated by NNResetArena
+#define NNArenaAlignment 32
+
+// n rounded up to a multiple of the number of NNFloat in NNArenaAlignment
+#define NNArenaRound(n) \
+	(((n) + (int)(NNArenaAlignment / sizeof(NNFloat)) - 1) \
+		& ~((int)(NNArenaAlignment / sizeof(NNFloat)) - 1))
+
 typedef enum {
 	NNActivationIdentity = 0,
 	NNActivationTanh,
 	NNActivationSigmoid
 } NNActivation;
 
+// computation of tanh (and sigmoid) in activation functions
+typedef enum {
+	NNAccuracyExact = 0,	// libm tanh
+	NNAccuracyRational,	// rational approximation (max error 4e-7)
+	NNAccuracyTable	// interpolation in a table (max error 2.3e-7)
+} NNAccuracy;
+
+// update of weights and offsets by NNBackPropApply, with gradient g
+// (direction of decreasing cost) and learning rate eta
+typedef enum {
+	NNOptimizerSGD = 0,	// x += eta g
+	NNOptimizerMomentum,	// v = 0.9 v + g, x += eta v
+	NNOptimizerRMSProp,	// s = 0.9 s + 0.1 g^2, x += eta g / sqrt(s)
+	NNOptimizerAdam	// m and s with bias correction (beta1=0.9, beta2=0.999)
+} NNOptimizer;
+
+// vector kernels used by NNEval and backprop, selected for each layer by
+// NNAddLayer with NNSelectKernels()
+typedef struct {
+	// sum of a[i] * b[i] for i = 0..n-1
+	NNFloat (*dot)(NNFloat const *a, NNFloat const *b, int n);
+	// y[i] += a * x[i]
+	void (*axpy)(NNFloat *y, NNFloat const *x, int n, NNFloat a);
+	// sum of a[i] * x[index[i]] for i = 0..n-1
+	NNFloat (*sparseDot)(NNFloat const *a, int const *index, NNFloat const *x,
+		int n);
+	// y[i] = phi(p[i]) (y and p can be the same)
+	void (*activate)(NNFloat *y, NNFloat const *p, int n,
+		NNActivation activation, NNAccuracy accuracy);
+} NNKernels;
+
+// sets of kernels
+typedef enum {
+	NNKernelSetPortable = 0,
+	NNKernelSetSSE2,	// x86 with gcc or clang
+	NNKernelSetAVX2	// x86 with gcc or clang, also with FMA
+} NNKernelSet;
+
 typedef struct {
 	int inputCount;
 	int outputCount;
 	NNActivation activation;
+	NNKernels const *kernels;
 	NNFloat *data;  // block of data for w, b, input, output
-	NNFloat *W; // W[i * inputCount + j] between input j and output i
+	NNFloat *W; // W[i * inputCount + j] between input j and output i, or NULL
 	NNFloat *B;
 	NNFloat *input; // or NULL for output of previous layer
 	NNFloat *output;
+	// sparse layer (compressed sparse rows, for evaluation only) if W is NULL
+	int nonZeroCount;	// number of weights stored in Ws
+	int *rowStart;	// weights of output i at rowStart[i]..rowStart[i+1]-1
+	int *column;	// input index of each weight
+	NNFloat *Ws;	// value of each weight
+	int external;	// if nonzero, W and B are stored by the caller (possibly in
+		// read-only memory) and are never modified
 } NNLayer;
 
 typedef struct {
@@ -41,15 +97,25 @@ typedef struct {
 	int inputCount;
 	int outputCount;
 	NNLayer *layer;
+	NNAccuracy accuracy;
+	NNOptimizer optimizer;
+	void *arena;	// single block for layer array and all data, or NULL
+	int arenaSize;	// size of arena in bytes
+	uint32_t random[4];	// state of pseudorandom generator (xoshiro128**),
+		// all 0 until the first number if NNSeed has not been called
 } NN;
 
 typedef struct {
 	NNFloat **ptr;	// block of pointers for E
 	NNFloat *data;	// block of data for E
 	NNFloat *E;	// E[i] = error for layer i
-	NNFloat **P;	// P[i] = W[i] * y[i-1] + B[i] (i.e. output before activation)
+	NNFloat *D;	// D[i] = error for layer i multiplied by derivative of activation
 	NNFloat **Wg;	// Wg[i] = weight gradient
 	NNFloat **Bg;	// Bg[i] = offset gradient
+	NNFloat **M;	// M[i] = velocity or 1st moment (offsets, then weights) or NULL
+	NNFloat **S;	// S[i] = 2nd moment (offsets, then weights) or NULL
+	NNOptimizer optimizer;	// optimizer of nn when NNBackPropInit was called
+	int t;	// number of calls of NNBackPropApply (for Adam bias correction)
 } NNBackProp;
 
 typedef struct {
@@ -58,25 +124,131 @@ typedef struct {
 	int inputCount;
 	int outputCount;
 	NNFloat *data;	// block of data for input and output data
+	NNFloat *priority;	// priority of each observation for NNSamplingPriority
+	int ring;	// if nonzero, NNObservationsAdd replaces the oldest observation
+	int next;	// index of the next observation replaced in ring mode
+	int external;	// if nonzero, data and priority are owned by the caller
+		// (e.g. mapped file, see NNObservationsInitExternal)
 } NNObservations;
 
+// choice of observations for training
+typedef enum {
+	NNSamplingSweep = 0,	// all observations in order
+	NNSamplingUniform,	// random observations with the same probability
+	NNSamplingPriority,	// random observations with probability proportional
+		// to their priority (cost when they were used last)
+	NNSamplingShuffle	// all observations, shuffled before each pass
+} NNSampling;
+
+// state of training with observations split in several calls of
+// NNTrainingStep
+typedef struct {
+	NNObservations *obs;
+	NNFloat eta;
+	NNSampling sampling;
+	int batchSize;	// number of observations per step of backprop
+	int count;	// total number of observations to process
+	int done;	// number of observations processed
+	int batchDone;	// number of observations in the current batch
+	NNFloat costSum;	// sum of costs in the current pass over obs
+	NNFloat cost;	// mean cost of the last complete pass, or -1 if none
+		// (a pass is obs->count observations)
+} NNTraining;
+
+// get a set of kernels, or NULL if it is not compiled or not supported by
+// the cpu
+NNKernels const *NNGetKernels(NNKernelSet set);
+
+// get the fastest kernels supported by the cpu
+NNKernels const *NNSelectKernels(void);
+
+// tanh(x) computed with the specified accuracy
+NNFloat NNTanh(NNFloat x, NNAccuracy accuracy);
+
+// set accuracy of activation functions
+void NNSetAccuracy(NN *nn, NNAccuracy accuracy);
+
+// set optimizer used by NNBackPropApply (temporary memory for backprop
+// depends on it: the optimizer is effective after NNBackPropTempMemorySize
+// and NNBackPropInit)
+void NNSetOptimizer(NN *nn, NNOptimizer optimizer);
+
+// calculate size of memory (in bytes) required by NNResetArena for a network
+// of layerCount layers, with size[0] inputs and size[k+1] outputs in layer k
+int NNArenaSize(int layerCount, int const *size);
+
+// copy weights, offsets, inputs and outputs of a network allocated by
+// NNResetArena to another one with the same layer sizes, with a single
+// memcpy, returning 1 for success or 0 if the layouts differ
+int NNArenaCopy(NN *dest, NN const *src);
+
 // get address of nn inputs
 NNFloat *NNGetInputPtr(NN const *nn);
 
 // get address of nn outputs
 NNFloat *NNGetOutputPtr(NN const *nn);
 
-// initialize weights and offsets to 0
+// initialize weights and offsets to 0 (external layers are left unchanged)
 void NNClearWeights(NN *nn);
 
-// initialize weights to pseudo-random values and offsets to 0
+// set the seed of the pseudorandom generator of nn (a network whose
+// generator has not been seeded uses seed 0)
+void NNSeed(NN *nn, uint32_t seed);
+
+// next pseudorandom number of nn, uniform in [0, 2^32)
+uint32_t NNRandom(NN *nn);
+
+// advance the pseudorandom generator of nn by 2^64 numbers, to get
+// independent streams from copies of a network (e.g. for threads)
+void NNRandomJump(NN *nn);
+
+// initialize weights to pseudo-random values and offsets to 0 (external
+// layers are left unchanged)
 void NNInitWeights(NN *nn);
 
 // evaluate output of each layer from first to last
 // output before activation is stored in P[i] (if not NULL)
 void NNEval(NN *nn, NNFloat **P);
 
-// apply hebbian rule
+// calculate amount of temporary memory (in bytes) required for NNEvalBatch
+int NNEvalBatchTempMemorySize(NN *nn, int batchCount);
+
+// initialize storage for the outputs of hidden layers for NNEvalBatch
+NNFloat **NNEvalBatchInit(NN *nn, int batchCount, void *tempMem);
+
+// evaluate batchCount input vectors at once, layer by layer with a blocked
+// matrix-matrix product, without changing inputs and outputs of nn
+// input b is read at inputs[b * inputStride], output b is written at
+// outputs[b * outputStride], Y is the storage obtained by NNEvalBatchInit
+// (inputStride = inputCount + outputCount for the data of NNObservations);
+// results are the same as NNEval up to rounding errors
+void NNEvalBatch(NN *nn,
+	NNFloat const *inputs, int inputStride, int batchCount,
+	NNFloat *outputs, int outputStride, NNFloat **Y);
+
+// set to 0 weights of dense layers (except external layers) whose absolute
+// value is smaller than threshold, returning the number of remaining nonzero
+// weights
+int NNPrune(NN *nn, NNFloat threshold);
+
+// number of nonzero weights in a layer
+int NNLayerNonZeroCount(NNLayer const *layer);
+
+// set weights of a sparse layer to the nonzero elements of a dense
+// outputCount-by-inputCount matrix W, returning 1 for success or 0 if they
+// do not fit in the layer
+int NNSparseSetWeights(NNLayer *layer, NNFloat const *W);
+
+// check if a network has sparse layers, which can only be evaluated
+int NNHasSparseLayer(NN const *nn);
+
+// check if a network has external layers, which cannot be trained
+int NNHasExternalLayer(NN const *nn);
+
+// number of bytes used by the weights of nn (dense or sparse)
+int NNWeightMemorySize(NN const *nn);
+
+// apply hebbian rule (no effect on an external layer)
 void NNHebbianRuleStep(NN *nn, int layerIndex, NNFloat alpha);
 
 // calculate cost function for back propagation after NNEval()
@@ -85,19 +257,61 @@ NNFloat NNBackPropCost(NN *nn, NNFloat const *output);
 // calculate amount of temporary memory (in bytes) required for backprop
 int NNBackPropTempMemorySize(NN *nn);
 
-// initialize structures for backprop
+// initialize structures for backprop and reset optimizer state, returning
+// 1 for success or 0 if nn has external or sparse layers
 int NNBackPropInit(NN *nn, NNBackProp *bp, void *tempMem);
 
 // reset gradients for backprop
 void NNBackPropResetGradients(NN *nn, NNBackProp *bp);
 
-// add gradient based on 1st layer input and last layer output
+// add to the gradients the gradient based on 1st layer input and last layer
+// output (expected output for current input), so that gradients of several
+// observations can be accumulated before calling NNBackPropApply
 void NNBackPropAddGradients(NN *nn, NNBackProp *bp);
 
+// same as NNBackPropAddGradients for the expected output of the input, when
+// NNEval has already been called for it
+void NNBackPropAddGradientsAfterEval(NN *nn, NNBackProp *bp,
+	NNFloat const *output);
+
 // apply one step of back propagation using gradients obtained by
-// NNResetBackProp and NNAddGradients
+// NNBackPropResetGradients and NNBackPropAddGradients, with the optimizer
+// set when bp was initialized
 void NNBackPropApply(NN *nn, NNBackProp *bp, NNFloat eta);
 
+// apply one step of back propagation with the mean gradient of count
+// observations starting at first (wrapping around at obs->count)
+void NNBackPropBatch(NN *nn, NNBackProp *bp, NNObservations *obs,
+	int first, int count, NNFloat eta);
+
+// start training with iterCount passes over the observations of obs,
+// chosen by sampling, with the mean gradient of batches of batchSize
+// observations (the last batch of each pass can be smaller) and learning
+// rate eta
+void NNTrainingStart(NNTraining *training, NNObservations *obs,
+	int iterCount, int batchSize, NNFloat eta, NNSampling sampling);
+
+// continue training with at most maxSteps observations, returning the
+// number of observations which remain to be processed (0 when training is
+// complete); bp must have been initialized by NNBackPropInit
+int NNTrainingStep(NN *nn, NNBackProp *bp, NNTraining *training, int maxSteps);
+
+// add an observation, with the largest priority of other observations (or
+// 1), returning its index or -1 if obs is full and not in ring mode; if input
+// or output is NULL, the corresponding values are left to be set by the
+// caller with NNObservationGetPtr and the returned index
+int NNObservationsAdd(NNObservations *obs,
+	NNFloat const *input, NNFloat const *output);
+
+// get index of a random observation for sampling (NNSamplingUniform or
+// NNSamplingPriority) with the pseudorandom generator of nn, or -1 if there
+// is none
+int NNObservationsSample(NN *nn, NNObservations const *obs, NNSampling sampling);
+
+// shuffle observations with the pseudorandom generator of nn (in ring mode,
+// the observation replaced next is not the oldest anymore)
+void NNObservationsShuffle(NN *nn, NNObservations *obs);
+
 // get address of input and output vectors of an observation
 void NNObservationGetPtr(NNObservations *obs, int i,
 	NNFloat **input, NNFloat **output);
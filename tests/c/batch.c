@@ -0,0 +1,100 @@
+/*
+    Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+    Miniature Mobile Robots group, Switzerland
+    Author: Yves Piguet
+
+    Licensed under the 3-Clause BSD License;
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    https://opensource.org/licenses/BSD-3-Clause
+*/
+
+// test of NNEvalBatch compared with NNEval, for a dense network with more
+// inputs and outputs than the tiles of NNEvalBatch and batch sizes which are
+// not multiples of them
+
+#include "nn/nn.h"
+#include "nn/nn-alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define INPUTCOUNT 300
+#define BATCHMAX 67
+
+// maximum error accepted (sums split in partial dot products)
+#define ERRORMAX 1e-5
+
+// evaluate batchCount inputs with NNEvalBatch and NNEval, and return the
+// maximum error
+static double compare(NN *nn, int batchCount) {
+	static NNFloat input[BATCHMAX][INPUTCOUNT];
+	static NNFloat output[BATCHMAX][INPUTCOUNT];
+	double errMax = 0;
+
+	void *batchTempMem = malloc(NNEvalBatchTempMemorySize(nn, batchCount));
+	if (batchTempMem == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	NNFloat **Y = NNEvalBatchInit(nn, batchCount, batchTempMem);
+
+	for (int b = 0; b < batchCount; b++) {
+		for (int i = 0; i < nn->inputCount; i++) {
+			input[b][i] = (NNFloat)((7 * b + 3 * i) % 23) / 23 - 0.5;
+		}
+	}
+	NNEvalBatch(nn, &input[0][0], INPUTCOUNT, batchCount,
+		&output[0][0], INPUTCOUNT, Y);
+
+	NNFloat *nnInput = NNGetInputPtr(nn);
+	NNFloat *nnOutput = NNGetOutputPtr(nn);
+	for (int b = 0; b < batchCount; b++) {
+		for (int i = 0; i < nn->inputCount; i++) {
+			nnInput[i] = input[b][i];
+		}
+		NNEval(nn, NULL);
+		for (int i = 0; i < nn->outputCount; i++) {
+			double err = fabs(nnOutput[i] - output[b][i]);
+			if (err > errMax) {
+				errMax = err;
+			}
+		}
+	}
+
+	free(batchTempMem);
+	return errMax;
+}
+
+int main() {
+	NN nn = { 0, 0, 0, 0, 0 };   // empty
+	// layers with more inputs than NNBatchBlockInputs and more outputs than
+	// NNBatchBlockOutputs, none a multiple of them
+	int size[] = {INPUTCOUNT, 70, 150, 9};
+	NNActivation activation[] = {NNActivationTanh, NNActivationIdentity, NNActivationSigmoid};
+	int layerCount = sizeof(size) / sizeof(int) - 1;
+	int batchCount[] = {1, 5, 33, BATCHMAX};
+	int failed = 0;
+
+	NNReset(&nn, layerCount);
+	for (int k = 0; k < layerCount; k++) {
+		if (!NNAddLayer(&nn, size[k], size[k + 1], activation[k])) {
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+	}
+	NNSeed(&nn, 1);
+	NNInitWeights(&nn);
+
+	for (int i = 0; i < sizeof(batchCount) / sizeof(int); i++) {
+		double err = compare(&nn, batchCount[i]);
+		printf("Batch of %d: max error %g\n", batchCount[i], err);
+		if (err > ERRORMAX) {
+			printf("Error too large\n");
+			failed = 1;
+		}
+	}
+
+	NNReset(&nn, 0);
+	return failed;
+}
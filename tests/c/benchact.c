@@ -0,0 +1,122 @@
+/*
+    Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+    Miniature Mobile Robots group, Switzerland
+    Author: Yves Piguet
+
+    Licensed under the 3-Clause BSD License;
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    https://opensource.org/licenses/BSD-3-Clause
+*/
+
+// benchmark of accuracy modes of activation functions
+// (build with optimizations, e.g. make CFLAGS="-O2 -I." bench-nn-activation)
+
+#include "nn/nn.h"
+#include "nn/nn-alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static char const *accuracyName[] = {"exact", "rational", "table"};
+
+static double now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+// activation of a layer of 1024 neurons
+static double benchActivation(NNAccuracy accuracy, NNActivation activation) {
+	NNFloat p[1024], y[1024];
+	for (int i = 0; i < 1024; i++) {
+		p[i] = (i - 512) / 64.0;
+	}
+	NNKernels const *kernels = NNSelectKernels();
+	double t0 = now();
+	for (int n = 0; n < 20000; n++) {
+		kernels->activate(y, p, 1024, activation, accuracy);
+	}
+	return now() - t0;
+}
+
+// backprop with the observations of xor or random observations
+static double benchBackprop(NNAccuracy accuracy,
+	int layerCount, int const *size, NNActivation activation, int iter) {
+	NN nn = { 0, 0, 0, 0, 0 };   // empty
+	NNBackProp bp = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };	// empty
+	void *backpropTempMem = 0;
+	NNFloat xor[4][3] = {{0, 0, 0}, {0, 1, 1}, {1, 0, 1}, {1, 1, 0}};
+
+	NNReset(&nn, layerCount);
+	for (int k = 0; k < layerCount; k++) {
+		NNAddLayer(&nn, size[k], size[k + 1], activation);
+	}
+	NNSetAccuracy(&nn, accuracy);
+	NNSeed(&nn, 1);
+	NNInitWeights(&nn);
+	NNBackPropAllocStorage(&nn, &backpropTempMem);
+	NNBackPropInit(&nn, &bp, backpropTempMem);
+
+	NNFloat *nnInput = NNGetInputPtr(&nn);
+	NNFloat *nnOutput = NNGetOutputPtr(&nn);
+	double t0 = now();
+	for (int n = 0; n < iter; n++) {
+		for (int i = 0; i < nn.inputCount; i++) {
+			nnInput[i] = nn.inputCount == 2 ? xor[n % 4][i] : (NNFloat)((n + i) % 7) / 7;
+		}
+		for (int i = 0; i < nn.outputCount; i++) {
+			nnOutput[i] = nn.outputCount == 1 ? xor[n % 4][2] : (NNFloat)((n + i) % 3) / 3;
+		}
+		NNBackPropResetGradients(&nn, &bp);
+		NNBackPropAddGradients(&nn, &bp);
+		NNBackPropApply(&nn, &bp, 0.02);
+	}
+	double t = now() - t0;
+
+	NNBackPropAllocStorage(NULL, &backpropTempMem);
+	NNReset(&nn, 0);
+	return t;
+}
+
+int main() {
+	int sizeXor[] = {2, 3, 1};
+	int sizeWide[] = {64, 64, 8};
+	double t[3];
+
+	printf("%-28s", "");
+	for (int a = 0; a < 3; a++) {
+		printf("%20s", accuracyName[a]);
+	}
+	printf("\n");
+
+	printf("%-28s", "tanh layer (20000x1024)");
+	for (int a = 0; a < 3; a++) {
+		t[a] = benchActivation(a, NNActivationTanh);
+		printf("%12.3fs x%5.2f", t[a], t[0] / t[a]);
+	}
+	printf("\n");
+
+	printf("%-28s", "sigmoid layer (20000x1024)");
+	for (int a = 0; a < 3; a++) {
+		t[a] = benchActivation(a, NNActivationSigmoid);
+		printf("%12.3fs x%5.2f", t[a], t[0] / t[a]);
+	}
+	printf("\n");
+
+	printf("%-28s", "xor 2-3-1 tanh (100000 bp)");
+	for (int a = 0; a < 3; a++) {
+		t[a] = benchBackprop(a, 2, sizeXor, NNActivationTanh, 100000);
+		printf("%12.3fs x%5.2f", t[a], t[0] / t[a]);
+	}
+	printf("\n");
+
+	printf("%-28s", "64-64-8 sigmoid (20000 bp)");
+	for (int a = 0; a < 3; a++) {
+		t[a] = benchBackprop(a, 2, sizeWide, NNActivationSigmoid, 20000);
+		printf("%12.3fs x%5.2f", t[a], t[0] / t[a]);
+	}
+	printf("\n");
+
+	return 0;
+}
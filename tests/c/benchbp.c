@@ -0,0 +1,128 @@
+/*
+    Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+    Miniature Mobile Robots group, Switzerland
+    Author: Yves Piguet
+
+    Licensed under the 3-Clause BSD License;
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    https://opensource.org/licenses/BSD-3-Clause
+*/
+
+// benchmark of error propagation E := W' * D in backprop for a 256x256
+// layer, reading W column by column or row by row
+// (build with optimizations, e.g. make CFLAGS="-O2 -I." bench-nn-backprop)
+
+#include "nn/nn.h"
+#include "nn/nn-alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#define size 256
+#define iter 20000
+
+static double now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+// E[i] = sum of W[j,i] D[j] for j, with W read with a stride of n
+static void errorByColumns(NNFloat *E, NNFloat const *W, NNFloat const *D,
+	int m, int n) {
+	for (int i = 0; i < n; i++) {
+		E[i] = 0;
+		for (int j = 0; j < m; j++) {
+			E[i] += W[j * n + i] * D[j];
+		}
+	}
+}
+
+// same as errorByColumns, as a sum of rows of W weighted by D
+static void errorByRows(NNKernels const *kernels,
+	NNFloat *E, NNFloat const *W, NNFloat const *D, int m, int n) {
+	for (int i = 0; i < n; i++) {
+		E[i] = 0;
+	}
+	for (int j = 0; j < m; j++) {
+		kernels->axpy(E, &W[j * n], n, D[j]);
+	}
+}
+
+// backprop steps of a network with 2 layers of size x size
+static double benchBackprop(void) {
+	NN nn = { 0, 0, 0, 0, 0 };   // empty
+	NNBackProp bp = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };	// empty
+	void *backpropTempMem = 0;
+	int nnSize[] = {size, size, size};
+
+	NNResetArena(&nn, 2, nnSize);
+	NNAddLayer(&nn, size, size, NNActivationTanh);
+	NNAddLayer(&nn, size, size, NNActivationTanh);
+	NNSeed(&nn, 1);
+	NNInitWeights(&nn);
+	NNBackPropAllocStorage(&nn, &backpropTempMem);
+	NNBackPropInit(&nn, &bp, backpropTempMem);
+
+	NNFloat *nnInput = NNGetInputPtr(&nn);
+	NNFloat *nnOutput = NNGetOutputPtr(&nn);
+	double t0 = now();
+	for (int n = 0; n < iter / 10; n++) {
+		for (int i = 0; i < size; i++) {
+			nnInput[i] = (NNFloat)((n + i) % 7) / 7;
+			nnOutput[i] = (NNFloat)((n + i) % 3) / 3;
+		}
+		NNBackPropResetGradients(&nn, &bp);
+		NNBackPropAddGradients(&nn, &bp);
+		NNBackPropApply(&nn, &bp, 0.001);
+	}
+	double t = now() - t0;
+
+	NNBackPropAllocStorage(NULL, &backpropTempMem);
+	NNReset(&nn, 0);
+	return t;
+}
+
+int main() {
+	NNKernels const *kernels = NNSelectKernels();
+	NNFloat *W = malloc(size * size * sizeof(NNFloat));
+	NNFloat D[size], E1[size], E2[size];
+
+	for (int i = 0; i < size * size; i++) {
+		W[i] = (NNFloat)(i % 17) / 17 - 0.5;
+	}
+	for (int j = 0; j < size; j++) {
+		D[j] = (NNFloat)(j % 5) / 5 - 0.4;
+	}
+
+	double t0 = now();
+	for (int n = 0; n < iter; n++) {
+		errorByColumns(E1, W, D, size, size);
+	}
+	double tColumns = now() - t0;
+
+	t0 = now();
+	for (int n = 0; n < iter; n++) {
+		errorByRows(kernels, E2, W, D, size, size);
+	}
+	double tRows = now() - t0;
+
+	NNFloat errMax = 0;
+	for (int i = 0; i < size; i++) {
+		if (fabs(E1[i] - E2[i]) > errMax) {
+			errMax = fabs(E1[i] - E2[i]);
+		}
+	}
+
+	printf("E := W' D, %dx%d, %d times\n", size, size, iter);
+	printf("  by columns (strided):   %8.3fs\n", tColumns);
+	printf("  by rows (sequential):   %8.3fs x%5.2f\n", tRows, tColumns / tRows);
+	printf("  max difference:         %8.2g\n", errMax);
+	printf("Backprop %d-%d-%d tanh, %d steps: %8.3fs\n",
+		size, size, size, iter / 10, benchBackprop());
+
+	free(W);
+	return 0;
+}
@@ -0,0 +1,140 @@
+/*
+    Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+    Miniature Mobile Robots group, Switzerland
+    Author: Yves Piguet
+
+    Licensed under the 3-Clause BSD License;
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    https://opensource.org/licenses/BSD-3-Clause
+*/
+
+// benchmark of parallel training: time to reach a given error with
+// synchronous mini-batches and with lock-free Hogwild updates, on a
+// synthetic dataset with sparse inputs
+// (build with optimizations, e.g. make CFLAGS="-O2 -I." bench-nn-hogwild)
+// usage: bench-nn-hogwild [maxthreads]
+
+#include "nn/nn.h"
+#include "nn/nn-alloc.h"
+#include "nn/nn-parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#define inputCount 256
+#define nonZeroInputCount 8
+#define hiddenCount 16
+#define obsCount 4096
+#define syncBatchSize 32
+#define eta 0.1	// hogwild, one observation per step
+#define etaSync 2	// sync, mean gradient of syncBatchSize observations
+#define errorRMSMax 0.05
+#define maxEpochs 200
+
+static double now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+// observations with a few nonzero inputs and an output which depends on
+// them in a nonlinear way
+static void makeDataset(NNObservations *obs) {
+	NNFloat w[inputCount];
+
+	srand(1);
+	for (int j = 0; j < inputCount; j++) {
+		w[j] = (NNFloat)rand() / RAND_MAX - 0.5;
+	}
+	NNObservationsInit(obs, inputCount, 1, obsCount);
+	for (obs->count = 0; obs->count < obsCount; obs->count++) {
+		NNFloat *input, *output;
+		NNObservationGetPtr(obs, obs->count, &input, &output);
+		for (int j = 0; j < inputCount; j++) {
+			input[j] = 0;
+		}
+		NNFloat s = 0;
+		for (int j = 0; j < nonZeroInputCount; j++) {
+			int k = rand() % inputCount;
+			input[k] = 1;
+			s += w[k];
+		}
+		output[0] = 0.5 * tanh(s);
+	}
+}
+
+static NNFloat errorRMS(NN *nn, NNObservations *obs) {
+	NNFloat *nnInput = NNGetInputPtr(nn);
+	NNFloat *nnOutput = NNGetOutputPtr(nn);
+	NNFloat s = 0;
+
+	for (int i = 0; i < obs->count; i++) {
+		NNFloat *input, *output;
+		NNObservationGetPtr(obs, i, &input, &output);
+		for (int j = 0; j < inputCount; j++) {
+			nnInput[j] = input[j];
+		}
+		NNEval(nn, NULL);
+		s += (nnOutput[0] - output[0]) * (nnOutput[0] - output[0]);
+	}
+	return sqrt(s / obs->count);
+}
+
+// train until the rms error is below errorRMSMax, returning the training
+// time (excluding error evaluation) and the number of epochs
+static double train(NNObservations *obs, int threadCount, int hogwild,
+	int *epochs) {
+	NN nn = { 0, 0, 0, 0, 0 };   // empty
+	NNParallel par;
+	double t = 0;
+
+	NNReset(&nn, 2);
+	NNAddLayer(&nn, inputCount, hiddenCount, NNActivationTanh);
+	NNAddLayer(&nn, hiddenCount, 1, NNActivationTanh);
+	NNSeed(&nn, 2);
+	NNInitWeights(&nn);
+	if (!NNParallelInit(&par, &nn, threadCount)) {
+		fprintf(stderr, "Cannot start %d threads\n", threadCount);
+		exit(1);
+	}
+
+	for (*epochs = 1; *epochs <= maxEpochs; (*epochs)++) {
+		double t0 = now();
+		if (hogwild) {
+			NNParallelHogwild(&par, obs, 0, obs->count, eta);
+		} else {
+			for (int i = 0; i < obs->count; i += syncBatchSize) {
+				NNParallelBatch(&par, obs, i, syncBatchSize, etaSync);
+			}
+		}
+		t += now() - t0;
+		if (errorRMS(&nn, obs) <= errorRMSMax) {
+			break;
+		}
+	}
+
+	NNParallelFree(&par);
+	NNReset(&nn, 0);
+	return t;
+}
+
+int main(int argc, char **argv) {
+	NNObservations obs = { 0, 0, 0, 0, 0 };	// empty
+	int maxThreadCount = argc > 1 ? strtol(argv[1], NULL, 0) : 8;
+
+	makeDataset(&obs);
+
+	printf("%-10s%24s%24s\n", "threads", "sync (batch 32)", "hogwild");
+	for (int threadCount = 1; threadCount <= maxThreadCount; threadCount *= 2) {
+		int epochsSync, epochsHogwild;
+		double tSync = train(&obs, threadCount, 0, &epochsSync);
+		double tHogwild = train(&obs, threadCount, 1, &epochsHogwild);
+		printf("%-10d%12.3fs %3d epochs%12.3fs %3d epochs\n",
+			threadCount, tSync, epochsSync, tHogwild, epochsHogwild);
+	}
+
+	NNObservationsInit(&obs, 0, 0, 0);
+	return 0;
+}
@@ -13,80 +13,81 @@
 
 #include "nn/nn.h"
 #include "nn/nn-alloc.h"
+#include "nn/nn-parallel.h"
+#include "nn/nn-quant.h"
+#include "nn/nn-fixed.h"
+#include "nn/nn-codegen.h"
+#include "nn/nn-dataset.h"
+#include "nn/nn-model.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
 
-#define maxLineLength 1024
+// maximum number of observations evaluated at once for validation
+#define VALIDATIONCHUNK 1024
 
-static int countFileLines(char const *path) {
-	FILE *fp = fopen(path, "r");
-	if (fp == NULL) {
-		fprintf(stderr, "Cannot open file %s\n", path);
-		exit(1);
-	}
-
-	int count = 0;
-	for (count = 0; !feof(fp); ) {
-		char line[maxLineLength];
-		if (fgets(line, maxLineLength, fp)) {
-			count++;
+// load a binary dataset (mapped in memory) or a CSV dataset (in a ring
+// buffer of ringSize observations if ringSize > 0)
+static void loadDataset(char const *path, NN const *nn, NNObservations *obs,
+	int ringSize) {
+	int ok;
+	if (NNObservationsIsBinaryFile(path)) {
+		if (ringSize > 0) {
+			fprintf(stderr, "Option --ring is not supported with binary file %s\n", path);
+			exit(1);
 		}
+		ok = NNObservationsMapBinary(obs, path)
+			&& obs->inputCount == nn->inputCount
+			&& obs->outputCount == nn->outputCount;
+	} else {
+		// capacity of ring buffer, or growing as needed
+		NNObservationsInit(obs, nn->inputCount, nn->outputCount, ringSize);
+		obs->ring = ringSize > 0;
+		ok = NNObservationsLoadCSV(obs, path);
 	}
-	fclose(fp);
-	return count;
-}
-
-static void loadCSV(char const *path, NNObservations *obs) {
-	double x;
-	int i;
-	NNFloat *input, *output;
-
-	FILE *fp = fopen(path, "r");
-	if (fp == NULL) {
-		fprintf(stderr, "Cannot open file %s\n", path);
+	if (!ok) {
+		fprintf(stderr, "Cannot load file %s\n", path);
 		exit(1);
 	}
+}
 
-	for (obs->count = i = 0;;) {
-		int r = fscanf(fp, "%lf,", &x);
-		if (r == 1) {
-			NNObservationGetPtr(obs, obs->count, &input, &output);
-			if (i < obs->inputCount) {
-				input[i++] = (NNFloat)x;
-			} else {
-				output[i++ - obs->inputCount] = (NNFloat)x;
-				if (i >= obs->inputCount + obs->outputCount) {
-					i = 0;
-					obs->count++;
-				}
-			}
-		} else {
-			break;	// eof
-		}
+static void freeDataset(NNObservations *obs) {
+	if (obs->external) {
+		NNObservationsUnmap(obs);
+	} else {
+		NNObservationsInit(obs, 0, 0, 0);
 	}
-
-	fclose(fp);
 }
 
 int main(int argc, char **argv) {
 	NN nn = { 0, 0, 0, 0, 0 };   // empty
-	NNBackProp bp = { 0, 0, 0, 0, 0, 0 };	// empty
+	NNBackProp bp = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };	// empty
 	NNObservations obs = { 0, 0, 0, 0, 0 };	// empty
 	int layerCount;
 	int inputCount;
 	int maxIter = 1;
+	int batchSize = 1;
+	int threadCount = 1;
+	int hogwild = 0;
+	int quantize = 0;
+	int slice = 0;
+	NNSampling sampling = NNSamplingSweep;
+	int ringSize = 0;
 	NNFloat eta = 0.02;
 	void *backpropTempMem = 0;
 	char const *trainingDatasetPath = NULL;
 	char const *validationDatasetPath = NULL;
+	char const *codegenPath = NULL;
+	char const *loadPath = NULL;
+	char const *mapPath = NULL;
+	char const *savePath = NULL;
+	void *mapping = NULL;
 	NNFloat errormax = -1;	// default: no check
-	int obsCount = 0;
 	int verbose = 0;
 	int quiet = 0;
 
-	// count layers and decode --input
+	// count layers and decode --input, --load and --map
 	layerCount = 0;
 	inputCount = 0;
 	for (int i = 1; i < argc; i++) {
@@ -94,17 +95,67 @@ int main(int argc, char **argv) {
 			inputCount = strtol(argv[++i], NULL, 0);
 		} else if (strcmp(argv[i], "--layer") == 0) {
 			layerCount++;
+		} else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+			loadPath = argv[++i];
+		} else if (strcmp(argv[i], "--map") == 0 && i + 1 < argc) {
+			mapPath = argv[++i];
 		}
 	}
+	if ((loadPath || mapPath) && layerCount > 0) {
+		fprintf(stderr, "--layer cannot be combined with --load or --map\n");
+		exit(1);
+	}
 
-	NNReset(&nn, layerCount);
+	// allocate all layers at once
+	int *size = malloc((layerCount + 1) * sizeof(int));
+	size[0] = inputCount;
+	for (int i = 1, k = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--layer") == 0 && i + 1 < argc) {
+			size[k++] = strtol(argv[++i], NULL, 0);
+		}
+	}
+	if (layerCount > 0 && !NNResetArena(&nn, layerCount, size)) {
+		fprintf(stderr, "Cannot allocate network\n");
+		exit(1);
+	}
+	free(size);
+
+	if (loadPath && !NNLoad(&nn, loadPath)) {
+		fprintf(stderr, "Cannot load network from %s\n", loadPath);
+		exit(1);
+	} else if (mapPath && !NNLoadMapped(&nn, mapPath, &mapping)) {
+		fprintf(stderr, "Cannot map network from %s\n", mapPath);
+		exit(1);
+	}
 
 	int nextLayerInputCount = inputCount;
 	for (int i = 1; i < argc; i++) {
-		if (strcmp(argv[i], "--errormax") == 0 && i + 1 < argc) {
+		if (strcmp(argv[i], "--accuracy") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "exact") == 0) {
+				NNSetAccuracy(&nn, NNAccuracyExact);
+			} else if (strcmp(argv[i], "rational") == 0) {
+				NNSetAccuracy(&nn, NNAccuracyRational);
+			} else if (strcmp(argv[i], "table") == 0) {
+				NNSetAccuracy(&nn, NNAccuracyTable);
+			} else {
+				fprintf(stderr, "Unknown accuracy %s\n", argv[i]);
+				exit(1);
+			}
+		} else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+			batchSize = strtol(argv[++i], NULL, 0);
+			if (batchSize < 1) {
+				fprintf(stderr, "Batch size must be at least 1\n");
+				exit(1);
+			}
+		} else if (strcmp(argv[i], "--codegen") == 0 && i + 1 < argc) {
+			codegenPath = argv[++i];
+		} else if (strcmp(argv[i], "--errormax") == 0 && i + 1 < argc) {
 			errormax = strtod(argv[++i], NULL);
 		} else if (strcmp(argv[i], "--eta") == 0 && i + 1 < argc) {
 			eta = strtod(argv[++i], NULL);
+		} else if (strcmp(argv[i], "--hogwild") == 0) {
+			hogwild = 1;
 		} else if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
 			i++;	// already parsed
 		} else if (strcmp(argv[i], "--iter") == 0 && i + 1 < argc) {
@@ -123,8 +174,52 @@ int main(int argc, char **argv) {
 			}
 			NNAddLayer(&nn, nextLayerInputCount, outputCount, act);
 			nextLayerInputCount = outputCount;
+		} else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+			i++;	// already parsed
+		} else if (strcmp(argv[i], "--map") == 0 && i + 1 < argc) {
+			i++;	// already parsed
+		} else if (strcmp(argv[i], "--optimizer") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "sgd") == 0) {
+				NNSetOptimizer(&nn, NNOptimizerSGD);
+			} else if (strcmp(argv[i], "momentum") == 0) {
+				NNSetOptimizer(&nn, NNOptimizerMomentum);
+			} else if (strcmp(argv[i], "rmsprop") == 0) {
+				NNSetOptimizer(&nn, NNOptimizerRMSProp);
+			} else if (strcmp(argv[i], "adam") == 0) {
+				NNSetOptimizer(&nn, NNOptimizerAdam);
+			} else {
+				fprintf(stderr, "Unknown optimizer %s\n", argv[i]);
+				exit(1);
+			}
+		} else if (strcmp(argv[i], "--quantize") == 0) {
+			quantize = 1;
 		} else if (strcmp(argv[i], "--quiet") == 0) {
 			quiet = 1;
+		} else if (strcmp(argv[i], "--ring") == 0 && i + 1 < argc) {
+			ringSize = strtol(argv[++i], NULL, 0);
+		} else if (strcmp(argv[i], "--sampling") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "sweep") == 0) {
+				sampling = NNSamplingSweep;
+			} else if (strcmp(argv[i], "uniform") == 0) {
+				sampling = NNSamplingUniform;
+			} else if (strcmp(argv[i], "priority") == 0) {
+				sampling = NNSamplingPriority;
+			} else if (strcmp(argv[i], "shuffle") == 0) {
+				sampling = NNSamplingShuffle;
+			} else {
+				fprintf(stderr, "Unknown sampling %s\n", argv[i]);
+				exit(1);
+			}
+		} else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+			savePath = argv[++i];
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			NNSeed(&nn, strtoul(argv[++i], NULL, 0));
+		} else if (strcmp(argv[i], "--slice") == 0 && i + 1 < argc) {
+			slice = strtol(argv[++i], NULL, 0);
+		} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			threadCount = strtol(argv[++i], NULL, 0);
 		} else if (strcmp(argv[i], "--training") == 0 && i + 1 < argc) {
 			trainingDatasetPath = argv[++i];
 		} else if (strcmp(argv[i], "--validation") == 0 && i + 1 < argc) {
@@ -135,19 +230,50 @@ int main(int argc, char **argv) {
 			printf("Usage: %s [options]\n"
 				"\n"
 				"Options:\n"
+				"  --accuracy a       accuracy of tanh and sigmoid (\"exact\" (default),\n"
+				"                     \"rational\" or \"table\")\n"
+				"  --batch n          number of observations per step of backprop\n"
+				"                     (default: 1)\n"
+				"  --codegen path     write C source of function eval(in, out) for the\n"
+				"                     fixed-point network after training, with inputs\n"
+				"                     scaled for the range of the training dataset\n"
 				"  --errormax x       maximum error accepted for validation\n"
 				"                     (default: no maximum)\n"
 				"  --eta x            eta learning rate\n"
 				"  --help             display this message and exit\n"
+				"  --hogwild          lock-free training where each thread updates weights\n"
+				"                     after each observation (--batch is ignored)\n"
 				"  --input n          number of inputs\n"
 				"  --iter n           number of iterations\n"
 				"  --layer n a        layer description with number of outputs n\n"
 				"                     and activation a (\"identity\", \"tanh\" or \"sigmoid\")\n"
+				"  --load path        load network saved with --save instead of --input\n"
+				"                     and --layer\n"
+				"  --map path         map network saved with --save in read-only memory\n"
+				"                     (evaluation only, without --training)\n"
+				"  --optimizer o      optimizer (\"sgd\" (default), \"momentum\", \"rmsprop\"\n"
+				"                     or \"adam\")\n"
+				"  --quantize         also validate the network with int8 weights and\n"
+				"                     display the accuracy loss\n"
 				"  --quiet            suppress output\n"
+				"  --ring n           keep only the last n observations of the training\n"
+				"                     dataset in a ring buffer (csv files only)\n"
+				"  --sampling s       choice of observations with --slice (\"sweep\"\n"
+				"                     (default), \"uniform\", \"priority\" or \"shuffle\")\n"
+				"  --save path        save network after training\n"
+				"  --seed n           seed of the pseudorandom generator used for initial\n"
+				"                     weights and sampling (default: 0)\n"
+				"  --slice n          resumable training by calls of NNTrainingStep for at\n"
+				"                     most n observations (--threads and --hogwild are\n"
+				"                     ignored)\n"
+				"  --threads n        number of threads which share the observations of\n"
+				"                     each batch (default: 1)\n"
 				"  --training path    dataset used for training (csv file where each row contains\n"
-				"                     the inputs and outputs of one observation)\n"
+				"                     the inputs and outputs of one observation, or binary\n"
+				"                     file written by nn-dataset-convert)\n"
 				"  --validation path  dataset used for validation (csv file where each row contains\n"
-				"                     the inputs and outputs of one observation)\n"
+				"                     the inputs and outputs of one observation, or binary\n"
+				"                     file written by nn-dataset-convert)\n"
 				"  --verbose          display diagnostic information\n"
 				, argv[0]);
 			exit(0);
@@ -167,47 +293,98 @@ int main(int argc, char **argv) {
 		printf("\n");
 	}
 
-	NNInitWeights(&nn);
+	if (mapPath && trainingDatasetPath) {
+		fprintf(stderr, "Network mapped with --map cannot be trained\n");
+		exit(1);
+	}
+	if (!loadPath && !mapPath) {
+		NNInitWeights(&nn);
+	}
 
 	NNBackPropAllocStorage(&nn, &backpropTempMem);
 	NNBackPropInit(&nn, &bp, backpropTempMem);
 
 	if (trainingDatasetPath) {
-		obsCount = countFileLines(trainingDatasetPath);
-		if (obsCount > 0) {
-			NNObservationsInit(&obs, nn.inputCount, nn.outputCount, obsCount);
-			loadCSV(trainingDatasetPath, &obs);
+		loadDataset(trainingDatasetPath, &nn, &obs, ringSize);
+		if (obs.count > 0) {
 			if (verbose) {
 				printf("Size of dataset used for training: %d\n", obs.count);
 				printf("Number of steps for training: %d\n", maxIter);
 				printf("Learning rate eta: %g\n", eta);
+				printf("Batch size: %d\n", batchSize);
+				printf("Number of threads: %d\n", threadCount);
+				if (hogwild) {
+					printf("Hogwild\n");
+				}
 			}
 			NNFloat costInitial = 0;
 			NNFloat costFinal = 0;
-			if (obs.count > 0) {
+			if (obs.count > 0 && slice > 0) {
+				// same number of passes over the dataset, in slices
+				NNTraining training;
+				NNTrainingStart(&training, &obs, (maxIter + obs.count - 1) / obs.count,
+					batchSize, eta, sampling);
+				int sliceCount = 0;
+				for (int remaining = 1; remaining > 0; sliceCount++) {
+					remaining = NNTrainingStep(&nn, &bp, &training, slice);
+				}
+				if (verbose) {
+					printf("Number of slices: %d\n", sliceCount);
+					printf("Final mean cost: %g\n", training.cost);
+				}
+			} else if (obs.count > 0) {
+				// in hogwild mode, threads are synchronized only once per epoch
+				if (hogwild) {
+					batchSize = obs.count;
+				}
+				int parallel = hogwild || threadCount > 1;
+				NNParallel par;
+				if (parallel && !NNParallelInit(&par, &nn, threadCount)) {
+					fprintf(stderr, "Cannot start %d threads\n", threadCount);
+					exit(1);
+				}
+
 				for (int i = 0; i < maxIter; i++) {
+					if (i % batchSize == 0 && !parallel) {
+						NNBackPropResetGradients(&nn, &bp);
+					}
+
 					NNFloat *input, *output;
 					NNObservationGetPtr(&obs, i % obs.count, &input, &output);
 
-					NNFloat *nnInput = NNGetInputPtr(&nn);
-					NNFloat *nnOutput = NNGetOutputPtr(&nn);
-					for (int j = 0; j < nn.inputCount; j++) {
-						nnInput[j] = input[j];
-					}
-					if (i < obs.count) {
-						NNEval(&nn, NULL);
-						costInitial += NNBackPropCost(&nn, output);
-					} else if (i >= (maxIter / obs.count - 1) * obs.count && i < (maxIter / obs.count) * obs.count) {
+					int costInitialStep = i < obs.count;
+					int costFinalStep = i >= (maxIter / obs.count - 1) * obs.count
+						&& i < (maxIter / obs.count) * obs.count;
+					if (!parallel || costInitialStep || costFinalStep) {
+						NNFloat *nnInput = NNGetInputPtr(&nn);
+						for (int j = 0; j < nn.inputCount; j++) {
+							nnInput[j] = input[j];
+						}
 						NNEval(&nn, NULL);
-						costFinal += NNBackPropCost(&nn, output);
+						if (costInitialStep) {
+							costInitial += NNBackPropCost(&nn, output);
+						} else if (costFinalStep) {
+							costFinal += NNBackPropCost(&nn, output);
+						}
+					}
+
+					if (!parallel) {
+						NNBackPropAddGradientsAfterEval(&nn, &bp, output);
 					}
-					for (int j = 0; j < nn.outputCount; j++) {
-						nnOutput[j] = output[j];
+					if ((i + 1) % batchSize == 0 || i + 1 == maxIter) {
+						int n = i % batchSize + 1;
+						if (hogwild) {
+							NNParallelHogwild(&par, &obs, (i + 1 - n) % obs.count, n, eta);
+						} else if (parallel) {
+							NNParallelBatch(&par, &obs, (i + 1 - n) % obs.count, n, eta);
+						} else {
+							NNBackPropApply(&nn, &bp, eta / n);
+						}
 					}
+				}
 
-					NNBackPropResetGradients(&nn, &bp);
-					NNBackPropAddGradients(&nn, &bp);
-					NNBackPropApply(&nn, &bp, eta);
+				if (parallel) {
+					NNParallelFree(&par);
 				}
 				if (verbose) {
 					printf("Initial cost: %g\n", costInitial);
@@ -217,25 +394,105 @@ int main(int argc, char **argv) {
 		}
 	}
 
+	if (savePath && !NNSave(&nn, savePath)) {
+		fprintf(stderr, "Cannot save network to %s\n", savePath);
+		exit(1);
+	}
+
+	if (codegenPath) {
+		// largest number of fractional bits for the inputs of the training
+		// dataset
+		NNFloat inputMax = 1;
+		for (int i = 0; i < obs.count; i++) {
+			NNFloat *input, *output;
+			NNObservationGetPtr(&obs, i, &input, &output);
+			for (int j = 0; j < nn.inputCount; j++) {
+				if (fabs(input[j]) > inputMax) {
+					inputMax = fabs(input[j]);
+				}
+			}
+		}
+		int inputShift = 14;
+		while (inputShift > -15 && inputMax * ldexp(1, inputShift) > 32767) {
+			inputShift--;
+		}
+
+		NNFixed fnn;
+		void *fixedMem = NULL;
+		FILE *fp = NULL;
+		if (!NNFixedAllocStorage(&nn, &fixedMem)
+			|| !NNFixedConvert(&fnn, &nn, fixedMem, inputShift, inputMax)
+			|| (fp = fopen(codegenPath, "w")) == NULL
+			|| !NNFixedWriteC(&fnn, fp, "eval")
+			|| fclose(fp) != 0) {
+			fprintf(stderr, "Cannot write code to %s\n", codegenPath);
+			exit(1);
+		}
+		if (!quiet) {
+			printf("Code written to %s (%d fractional bits for inputs, %d for outputs)\n",
+				codegenPath, inputShift, fnn.layer[fnn.layerCount - 1].outputShift);
+		}
+		NNFixedAllocStorage(NULL, &fixedMem);
+	}
+
 	if (validationDatasetPath) {
-		obsCount = countFileLines(validationDatasetPath);
-		if (obsCount > 0) {
-			NNObservationsInit(&obs, nn.inputCount, nn.outputCount, obsCount);
-			loadCSV(validationDatasetPath, &obs);
-			if (verbose) {
-				printf("\nSize of dataset used for validation: %d\n", obs.count);
+		freeDataset(&obs);
+		loadDataset(validationDatasetPath, &nn, &obs, 0);
+		if (verbose) {
+			printf("\nSize of dataset used for validation: %d\n", obs.count);
+		}
+		if (obs.count > 0) {
+			// evaluate the dataset by chunks of at most VALIDATIONCHUNK
+			// observations, with the same temporary memory for all chunks
+			int chunkSize = obs.count < VALIDATIONCHUNK ? obs.count : VALIDATIONCHUNK;
+			void *batchTempMem = malloc(NNEvalBatchTempMemorySize(&nn, chunkSize));
+			NNFloat *batchOutput = malloc(chunkSize * nn.outputCount * sizeof(NNFloat));
+			if (batchTempMem == NULL || batchOutput == NULL) {
+				fprintf(stderr, "Out of memory\n");
+				exit(1);
 			}
-			if (obs.count > 0) {
-				for (int i = 0; i < obs.count; i++) {
-					NNFloat *input, *output;
+			NNFloat **Y = NNEvalBatchInit(&nn, chunkSize, batchTempMem);
+
+			// mean absolute error of float and int8 networks
+			NNQuant qnn;
+			void *quantMem = NULL;
+			NNFloat *qnnInput = NULL, *qnnOutput = NULL;
+			double errFloat = 0, errQuant = 0, diffMax = 0;
+			if (quantize) {
+				if (!NNQuantAllocStorage(&nn, &quantMem)
+					|| !NNQuantConvert(&qnn, &nn, quantMem)) {
+					fprintf(stderr, "Cannot quantize network\n");
+					exit(1);
+				}
+				qnnInput = NNQuantGetInputPtr(&qnn);
+				qnnOutput = NNQuantGetOutputPtr(&qnn);
+			}
+
+			for (int i0 = 0; i0 < obs.count; i0 += chunkSize) {
+				int count = i0 + chunkSize <= obs.count ? chunkSize : obs.count - i0;
+				NNFloat *input, *output;
+				NNObservationGetPtr(&obs, i0, &input, &output);
+				NNEvalBatch(&nn, input, obs.inputCount + obs.outputCount, count,
+					batchOutput, nn.outputCount, Y);
+
+				for (int i = i0; i < i0 + count; i++) {
 					NNObservationGetPtr(&obs, i, &input, &output);
 
-					NNFloat *nnInput = NNGetInputPtr(&nn);
-					NNFloat *nnOutput = NNGetOutputPtr(&nn);
-					for (int j = 0; j < nn.inputCount; j++) {
-						nnInput[j] = input[j];
+					NNFloat *nnOutput = &batchOutput[(i - i0) * nn.outputCount];
+
+					if (quantize) {
+						for (int j = 0; j < nn.inputCount; j++) {
+							qnnInput[j] = input[j];
+						}
+						NNQuantEval(&qnn);
+						for (int j = 0; j < nn.outputCount; j++) {
+							errFloat += fabs(output[j] - nnOutput[j]);
+							errQuant += fabs(output[j] - qnnOutput[j]);
+							if (fabs(qnnOutput[j] - nnOutput[j]) > diffMax) {
+								diffMax = fabs(qnnOutput[j] - nnOutput[j]);
+							}
+						}
 					}
-					NNEval(&nn, NULL);
 
 					if (!quiet) {
 						printf("Expected: ");
@@ -263,8 +520,29 @@ int main(int argc, char **argv) {
 					}
 				}
 			}
+
+			if (quantize) {
+				errFloat /= obs.count * nn.outputCount;
+				errQuant /= obs.count * nn.outputCount;
+				if (!quiet) {
+					printf("Weight memory: float %d bytes, int8 %d bytes\n",
+						NNWeightMemorySize(&nn), NNQuantWeightMemorySize(&qnn));
+					printf("Mean absolute validation error: float %g, int8 %g (loss %g)\n",
+						errFloat, errQuant, errQuant - errFloat);
+					printf("Max difference between float and int8 outputs: %g\n",
+						diffMax);
+				}
+				NNQuantAllocStorage(NULL, &quantMem);
+			}
+
+			free(batchOutput);
+			free(batchTempMem);
 		}
 	}
 
+	freeDataset(&obs);
+	NNBackPropAllocStorage(NULL, &backpropTempMem);
+	NNReset(&nn, 0);
+	NNLoadMapped(NULL, NULL, &mapping);
 	return 0;
 }
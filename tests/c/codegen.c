@@ -0,0 +1,145 @@
+/*
+    Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+    Miniature Mobile Robots group, Switzerland
+    Author: Yves Piguet
+
+    Licensed under the 3-Clause BSD License;
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    https://opensource.org/licenses/BSD-3-Clause
+*/
+
+// test of code generation: compiled with -DGENERATE, write the C source of
+// a network (gen-nn-codegen); otherwise, compare the generated function,
+// compiled and linked with this file, to NNFixedEval (test-nn-codegen)
+
+#include "nn/nn.h"
+#include "nn/nn-fixed.h"
+#include "nn/nn-codegen.h"
+#include "nn/nn-alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define EVALCOUNT 10000
+
+#define INPUTSHIFT 12
+#define INPUTMAX 4
+
+// network with all activation functions, with the same weights and offsets
+// in both programs
+static void initNN(NN *nn) {
+	int size[] = {7, 16, 8, 4};
+	NNActivation activation[] = {
+		NNActivationTanh, NNActivationSigmoid, NNActivationIdentity
+	};
+	NNReset(nn, 3);
+	for (int k = 0; k < 3; k++) {
+		NNAddLayer(nn, size[k], size[k + 1], activation[k]);
+	}
+	srand(1);
+	NNSeed(nn, 1);
+	NNInitWeights(nn);
+	for (int k = 0; k < 3; k++) {
+		for (int i = 0; i < nn->layer[k].outputCount; i++) {
+			nn->layer[k].B[i] = 0.5 * rand() / RAND_MAX - 0.25;
+		}
+	}
+}
+
+// network with large weights whose sums saturate for full-scale integer
+// inputs (input shift 0)
+#define SATURATEDINPUTMAX 32767
+
+static void initNNSaturated(NN *nn) {
+	NNReset(nn, 2);
+	NNAddLayer(nn, 2, 4, NNActivationTanh);
+	NNAddLayer(nn, 4, 2, NNActivationIdentity);
+	NNSeed(nn, 2);
+	NNInitWeights(nn);
+	for (int i = 0; i < 2 * 4; i++) {
+		nn->layer[0].W[i] = i % 3 ? 1000 : -1000;
+	}
+}
+
+static void convert(NN *nn, NNFixed *fnn, void **fixedMem,
+	int inputShift, NNFloat inputMax) {
+	if (!NNFixedAllocStorage(nn, fixedMem)
+		|| !NNFixedConvert(fnn, nn, *fixedMem, inputShift, inputMax)) {
+		fprintf(stderr, "Cannot convert network\n");
+		exit(1);
+	}
+}
+
+#if defined(GENERATE)
+
+static void generate(NNFixed const *fnn, char const *path, char const *name) {
+	FILE *fp = fopen(path, "w");
+	if (fp == NULL || !NNFixedWriteC(fnn, fp, name) || fclose(fp) != 0) {
+		fprintf(stderr, "Cannot write %s\n", path);
+		exit(1);
+	}
+}
+
+#else
+
+void eval(int16_t const *in, int16_t *out);
+void evalSaturated(int16_t const *in, int16_t *out);
+
+// number of different outputs of NNFixedEval and of generated function
+// evalGenerated for random inputs in [-inputMax, inputMax] (fixed point)
+static int compare(NNFixed *fnn, void (*evalGenerated)(int16_t const *, int16_t *),
+	int inputMax) {
+	int16_t input[16];
+	int16_t output[16];
+	int16_t *fnnOutput = NNFixedGetOutputPtr(fnn);
+	int failureCount = 0;
+	for (int n = 0; n < EVALCOUNT; n++) {
+		for (int i = 0; i < fnn->inputCount; i++) {
+			input[i] = (int16_t)(rand() % (2 * inputMax + 1) - inputMax);
+		}
+		NNFixedEval(fnn, input);
+		evalGenerated(input, output);
+		for (int i = 0; i < fnn->outputCount; i++) {
+			if (output[i] != fnnOutput[i]) {
+				failureCount++;
+			}
+		}
+	}
+	printf("%d different outputs out of %d\n", failureCount,
+		fnn->outputCount * EVALCOUNT);
+	return failureCount;
+}
+
+#endif
+
+int main(int argc, char **argv) {
+	NN nn = { 0, 0, 0, 0, 0 };   // empty
+	NN nnSaturated = { 0, 0, 0, 0, 0 };   // empty
+	NNFixed fnn, fnnSaturated;
+	void *fixedMem = NULL;
+	void *fixedMemSaturated = NULL;
+
+	initNN(&nn);
+	convert(&nn, &fnn, &fixedMem, INPUTSHIFT, INPUTMAX);
+	initNNSaturated(&nnSaturated);
+	convert(&nnSaturated, &fnnSaturated, &fixedMemSaturated, 0, SATURATEDINPUTMAX);
+
+#if defined(GENERATE)
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s file.c saturated.c\n", argv[0]);
+		exit(1);
+	}
+	generate(&fnn, argv[1], "eval");
+	generate(&fnnSaturated, argv[2], "evalSaturated");
+	int failureCount = 0;
+#else
+	int failureCount = compare(&fnn, eval, INPUTMAX << INPUTSHIFT)
+		+ compare(&fnnSaturated, evalSaturated, SATURATEDINPUTMAX);
+#endif
+
+	NNFixedAllocStorage(NULL, &fixedMemSaturated);
+	NNFixedAllocStorage(NULL, &fixedMem);
+	NNReset(&nnSaturated, 0);
+	NNReset(&nn, 0);
+	return failureCount > 0 ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+/*
+	Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+	Miniature Mobile Robots group, Switzerland
+	Author: Yves Piguet
+
+	Licensed under the 3-Clause BSD License;
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+	https://opensource.org/licenses/BSD-3-Clause
+*/
+
+// test of the number parser of NNObservationsLoadCSV: values are compared
+// with strtod, and malformed numbers must make loading fail
+
+#include "nn/nn.h"
+#include "nn/nn-alloc.h"
+#include "nn/nn-dataset.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define CSVPATH "test-nn-dataset.csv"
+
+// numbers parsed exactly in the fast path, or by strtod
+static char const *numbers[] = {
+	"0", "-0", "+1", "007", "-0.5", "0.000123", ".25", "3.",
+	"00000000000000000000000000000001.5",
+	"0.00000000000000000000000000000000000015",
+	"3.14159265358979323846264338327950288",
+	"-123456789012345678901234567890",
+	"9007199254740993",	// 2^53 + 1
+	"1e22", "1e23", "1e-22", "1e-23", "2.5E+30", "-4.9e-30",
+	"0.1e-40", "12345678901234567890e-50", "1e38", "3.4028235e38",
+	"1e-45", "1e-50", "1e400", "-1e-400",
+	NULL
+};
+
+// numbers longer than numberLengthMax, approximated with pow
+static char const *longNumbers[] = {
+	"1234567890123456789012345678901234567890123456789012345678901234567890",
+	"0.000000000000000000000000000000000000000000000000000000000000000001234567",
+	NULL
+};
+
+// malformed numbers
+static char const *malformed[] = {
+	"1e", "1e+", ".", "-", "+", "e5", "abc", "1,-",
+	NULL
+};
+
+// write numbers separated by newlines to CSVPATH
+static void writeCSV(char const *const *numbers) {
+	FILE *fp = fopen(CSVPATH, "w");
+	if (fp == NULL) {
+		fprintf(stderr, "Cannot write %s\n", CSVPATH);
+		exit(1);
+	}
+	for (int i = 0; numbers[i]; i++) {
+		fprintf(fp, "%s\n", numbers[i]);
+	}
+	fclose(fp);
+}
+
+// load numbers with NNObservationsLoadCSV (one output per observation) and
+// compare them with strtod, returning the number of errors larger than
+// errorMax (relative)
+static int compare(char const *const *numbers, double errorMax) {
+	NNObservations obs = { 0, 0, 0, 0, 0 };	// empty
+	int errorCount = 0;
+
+	writeCSV(numbers);
+	NNObservationsInit(&obs, 0, 1, 0);
+	if (!NNObservationsLoadCSV(&obs, CSVPATH)) {
+		printf("Cannot load %s\n", CSVPATH);
+		return 1;
+	}
+	for (int i = 0; numbers[i]; i++) {
+		if (i >= obs.count) {
+			printf("%s: missing\n", numbers[i]);
+			errorCount++;
+			continue;
+		}
+		NNFloat *input, *output;
+		NNObservationGetPtr(&obs, i, &input, &output);
+		NNFloat expected = (NNFloat)strtod(numbers[i], NULL);
+		double err = expected == output[0] ? 0
+			: fabs(output[0] - expected) / fabs(expected);
+		if (err > errorMax) {
+			printf("%s: %.9g instead of %.9g\n", numbers[i], output[0], expected);
+			errorCount++;
+		}
+	}
+	NNObservationsInit(&obs, 0, 0, 0);
+	return errorCount;
+}
+
+// check that loading each malformed number fails, returning the number of
+// errors
+static int checkMalformed(char const *const *numbers) {
+	int errorCount = 0;
+	for (int i = 0; numbers[i]; i++) {
+		NNObservations obs = { 0, 0, 0, 0, 0 };	// empty
+		char const *single[] = {numbers[i], NULL};
+		writeCSV(single);
+		NNObservationsInit(&obs, 0, 1, 0);
+		if (NNObservationsLoadCSV(&obs, CSVPATH)) {
+			printf("%s: accepted\n", numbers[i]);
+			errorCount++;
+		}
+		NNObservationsInit(&obs, 0, 0, 0);
+	}
+	return errorCount;
+}
+
+int main() {
+	int errorCount = compare(numbers, 0)
+		+ compare(longNumbers, 1e-6)
+		+ checkMalformed(malformed);
+	remove(CSVPATH);
+
+	printf("%d error%s\n", errorCount, errorCount == 1 ? "" : "s");
+	return errorCount > 0;
+}
@@ -0,0 +1,100 @@
+/*
+	Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+	Miniature Mobile Robots group, Switzerland
+	Author: Yves Piguet
+
+	Licensed under the 3-Clause BSD License;
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+	https://opensource.org/licenses/BSD-3-Clause
+*/
+
+// conversion of a CSV dataset to a binary dataset
+
+#include "nn/nn.h"
+#include "nn/nn-alloc.h"
+#include "nn/nn-dataset.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// number of values in the first row of a CSV file, or -1 if it cannot be read
+static int countColumns(char const *path) {
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL) {
+		return -1;
+	}
+
+	int count = 0;
+	int inValue = 0;
+	for (int c = fgetc(fp); c != EOF && c != '\n'; c = fgetc(fp)) {
+		if (c == ',' || c == ' ' || c == '\t' || c == '\r') {
+			inValue = 0;
+		} else if (!inValue) {
+			inValue = 1;
+			count++;
+		}
+	}
+	fclose(fp);
+	return count;
+}
+
+int main(int argc, char **argv) {
+	NNObservations obs = { 0, 0, 0, 0, 0 };	// empty
+	int outputCount = 1;
+	char const *csvPath = NULL;
+	char const *binaryPath = NULL;
+	int quiet = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			outputCount = strtol(argv[++i], NULL, 0);
+		} else if (strcmp(argv[i], "--quiet") == 0) {
+			quiet = 1;
+		} else if (argv[i][0] != '-' && csvPath == NULL) {
+			csvPath = argv[i];
+		} else if (argv[i][0] != '-' && binaryPath == NULL) {
+			binaryPath = argv[i];
+		} else {
+			csvPath = NULL;
+			break;
+		}
+	}
+	if (csvPath == NULL || binaryPath == NULL) {
+		printf("Usage: %s [options] input.csv output.nnob\n"
+			"\n"
+			"Convert a CSV dataset, where each row contains the inputs and outputs\n"
+			"of one observation, to a binary dataset which can be mapped in memory.\n"
+			"\n"
+			"Options:\n"
+			"  --help             display this message and exit\n"
+			"  --output n         number of outputs, at the end of each row (default: 1)\n"
+			"  --quiet            suppress output\n"
+			, argv[0]);
+		exit(0);
+	}
+
+	int columnCount = countColumns(csvPath);
+	if (columnCount <= outputCount || outputCount <= 0) {
+		fprintf(stderr, "Cannot find %d outputs and at least one input in %s\n",
+			outputCount, csvPath);
+		exit(1);
+	}
+
+	if (!NNObservationsInit(&obs, columnCount - outputCount, outputCount, 0)
+		|| !NNObservationsLoadCSV(&obs, csvPath)) {
+		fprintf(stderr, "Cannot load file %s\n", csvPath);
+		exit(1);
+	}
+	if (!NNObservationsSaveBinary(&obs, binaryPath)) {
+		fprintf(stderr, "Cannot write file %s\n", binaryPath);
+		exit(1);
+	}
+	if (!quiet) {
+		printf("%d observations with %d inputs and %d outputs written to %s\n",
+			obs.count, obs.inputCount, obs.outputCount, binaryPath);
+	}
+
+	NNObservationsInit(&obs, 0, 0, 0);
+	return 0;
+}
@@ -0,0 +1,144 @@
+/*
+    Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+    Miniature Mobile Robots group, Switzerland
+    Author: Yves Piguet
+
+    Licensed under the 3-Clause BSD License;
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    https://opensource.org/licenses/BSD-3-Clause
+*/
+
+// test of fixed-point nn: comparison with floating-point evaluation
+
+#include "nn/nn.h"
+#include "nn/nn-fixed.h"
+#include "nn/nn-alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define EVALCOUNT 10000
+
+// maximum error accepted, relative to the range of outputs
+#define ERRORMAX 2e-3
+
+// compare outputs of nn and of its fixed-point version for random inputs
+// in [-inputMax, inputMax] with inputShift fractional bits, and return the
+// maximum error relative to max(1, largest output)
+static double compare(NN *nn, int inputShift, NNFloat inputMax) {
+	NNFixed fnn;
+	void *fixedMem = NULL;
+	int16_t input[256];
+	double errMax = 0;
+	double outputMax = 1;
+
+	if (!NNFixedAllocStorage(nn, &fixedMem)) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	NNFixedConvert(&fnn, nn, fixedMem, inputShift, inputMax);
+
+	NNFloat *nnInput = NNGetInputPtr(nn);
+	NNFloat *nnOutput = NNGetOutputPtr(nn);
+	int16_t *fnnOutput = NNFixedGetOutputPtr(&fnn);
+	int outputShift = fnn.layer[fnn.layerCount - 1].outputShift;
+	for (int n = 0; n < EVALCOUNT; n++) {
+		for (int i = 0; i < nn->inputCount; i++) {
+			int32_t x = (int32_t)round((2.0 * rand() / RAND_MAX - 1)
+				* inputMax * ldexp(1, inputShift));
+			input[i] = x > 32767 ? 32767 : x < -32768 ? -32768 : x;
+			nnInput[i] = ldexp(input[i], -inputShift);
+		}
+		NNEval(nn, NULL);
+		NNFixedEval(&fnn, input);
+		for (int i = 0; i < nn->outputCount; i++) {
+			double err = fabs(nnOutput[i] - ldexp(fnnOutput[i], -outputShift));
+			if (err > errMax) {
+				errMax = err;
+			}
+			if (fabs(nnOutput[i]) > outputMax) {
+				outputMax = fabs(nnOutput[i]);
+			}
+		}
+	}
+
+	NNFixedAllocStorage(NULL, &fixedMem);
+	return errMax / outputMax;
+}
+
+static int test(char const *name, int inputCount,
+	int layerCount, int const *outputCount, NNActivation const *activation,
+	int inputShift, NNFloat inputMax) {
+	NN nn = { 0, 0, 0, 0, 0 };   // empty
+
+	NNReset(&nn, layerCount);
+	for (int k = 0; k < layerCount; k++) {
+		NNAddLayer(&nn, k == 0 ? inputCount : outputCount[k - 1], outputCount[k],
+			activation[k]);
+	}
+	NNInitWeights(&nn);
+	// scale first layer for inputs in [-inputMax, inputMax]
+	for (int i = 0; i < nn.layer[0].inputCount * nn.layer[0].outputCount; i++) {
+		nn.layer[0].W[i] /= inputMax;
+	}
+	for (int k = 0; k < layerCount; k++) {
+		for (int i = 0; i < nn.layer[k].outputCount; i++) {
+			nn.layer[k].B[i] = 0.5 * rand() / RAND_MAX - 0.25;
+		}
+	}
+
+	double err = compare(&nn, inputShift, inputMax);
+	printf("%-24s max error: %.2e%s\n", name, err, err > ERRORMAX ? " (failure)" : "");
+	NNReset(&nn, 0);
+	return err <= ERRORMAX;
+}
+
+// network whose first layer has weights of magnitude weight, so that sums
+// for full-scale inputs saturate in fixed point
+static int testSaturation(char const *name, int inputCount, NNFloat weight) {
+	NN nn = { 0, 0, 0, 0, 0 };   // empty
+
+	NNReset(&nn, 2);
+	NNAddLayer(&nn, inputCount, 3, NNActivationTanh);
+	NNAddLayer(&nn, 3, 1, NNActivationTanh);
+	NNSeed(&nn, 1);
+	NNInitWeights(&nn);
+	for (int i = 0; i < inputCount * 3; i++) {
+		nn.layer[0].W[i] = rand() % 2 ? weight : -weight;
+	}
+
+	double err = compare(&nn, 0, 32767);
+	printf("%-24s max error: %.2e%s\n", name, err, err > ERRORMAX ? " (failure)" : "");
+	NNReset(&nn, 0);
+	return err <= ERRORMAX;
+}
+
+int main() {
+	int ok = 1;
+
+	{
+		int outputCount[] = {3, 1};
+		NNActivation activation[] = {NNActivationTanh, NNActivationTanh};
+		ok &= test("2-3-1 tanh, q14", 2, 2, outputCount, activation, 14, 1);
+	}
+	{
+		int outputCount[] = {16, 4};
+		NNActivation activation[] = {NNActivationTanh, NNActivationSigmoid};
+		ok &= test("7-16-4 sigmoid, sensors", 7, 2, outputCount, activation, 0, 4500);
+	}
+	{
+		int outputCount[] = {20, 10, 2};
+		NNActivation activation[] = {NNActivationTanh, NNActivationTanh, NNActivationIdentity};
+		ok &= test("9-20-10-2 identity", 9, 3, outputCount, activation, 8, 100);
+	}
+	{
+		int outputCount[] = {2};
+		NNActivation activation[] = {NNActivationIdentity};
+		ok &= test("100-2 identity", 100, 1, outputCount, activation, 0, 1000);
+	}
+	ok &= testSaturation("1-3-1 saturated", 1, 1000);
+	ok &= testSaturation("4-3-1 saturated", 4, 1000);
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+/*
+    Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+    Miniature Mobile Robots group, Switzerland
+    Author: Yves Piguet
+
+    Licensed under the 3-Clause BSD License;
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    https://opensource.org/licenses/BSD-3-Clause
+*/
+
+// test of SIMD kernels compared with portable kernels, for all lengths up to
+// LENGTHMAX (including lengths which are not multiples of the vector size)
+// and unaligned data
+
+#include "nn/nn.h"
+#include <stdio.h>
+#include <math.h>
+
+#define LENGTHMAX 40
+
+// maximum error accepted (relative for dot products, whose terms are summed
+// in a different order, absolute otherwise)
+#define ERRORMAX 1e-6
+
+static char const *setName[] = {"portable", "SSE2", "AVX2"};
+static char const *activationName[] = {"identity", "tanh", "sigmoid"};
+static char const *accuracyName[] = {"exact", "rational", "table"};
+
+// error relative to ref for sums larger than 1, absolute otherwise
+static double relativeError(NNFloat x, NNFloat ref) {
+	return fabs(x - ref) / (fabs(ref) > 1 ? fabs(ref) : 1);
+}
+
+// compare kernels with ref and return the maximum error
+static double compare(NNKernels const *kernels, NNKernels const *ref) {
+	NNFloat a[LENGTHMAX + 1], b[LENGTHMAX + 1];
+	NNFloat y[LENGTHMAX + 1], yRef[LENGTHMAX + 1];
+	int index[LENGTHMAX];
+	double errMax = 0;
+
+	for (int i = 0; i <= LENGTHMAX; i++) {
+		a[i] = (NNFloat)((5 * i) % 17) / 4 - 2;
+		b[i] = (NNFloat)((3 * i) % 13) / 3 - 2;
+	}
+	for (int i = 0; i < LENGTHMAX; i++) {
+		index[i] = (7 * i) % LENGTHMAX;
+	}
+
+	// arrays starting at a + 1 and b + 1 are not aligned on vectors
+	for (int n = 0; n <= LENGTHMAX; n++) {
+		double err = relativeError(kernels->dot(a + 1, b + 1, n),
+			ref->dot(a + 1, b + 1, n));
+		if (err > errMax) {
+			errMax = err;
+		}
+		err = relativeError(kernels->sparseDot(a + 1, index, b, n),
+			ref->sparseDot(a + 1, index, b, n));
+		if (err > errMax) {
+			errMax = err;
+		}
+
+		for (int i = 0; i <= LENGTHMAX; i++) {
+			y[i] = yRef[i] = b[i];
+		}
+		kernels->axpy(y + 1, a + 1, n, 0.75);
+		ref->axpy(yRef + 1, a + 1, n, 0.75);
+		for (int i = 0; i <= LENGTHMAX; i++) {
+			if (fabs(y[i] - yRef[i]) > errMax) {
+				errMax = fabs(y[i] - yRef[i]);
+			}
+		}
+
+		for (NNActivation activation = NNActivationIdentity;
+			activation <= NNActivationSigmoid; activation++) {
+			for (NNAccuracy accuracy = NNAccuracyExact;
+				accuracy <= NNAccuracyTable; accuracy++) {
+				for (int i = 0; i <= LENGTHMAX; i++) {
+					y[i] = yRef[i] = 0;
+				}
+				kernels->activate(y + 1, a + 1, n, activation, accuracy);
+				ref->activate(yRef + 1, a + 1, n, activation, accuracy);
+				for (int i = 0; i <= LENGTHMAX; i++) {
+					err = fabs(y[i] - yRef[i]);
+					if (err > errMax) {
+						errMax = err;
+					}
+					if (err > ERRORMAX) {
+						printf("%s with %s accuracy, length %d: error %g\n",
+							activationName[activation], accuracyName[accuracy],
+							n, err);
+					}
+				}
+			}
+		}
+	}
+
+	return errMax;
+}
+
+int main() {
+	NNKernels const *ref = NNGetKernels(NNKernelSetPortable);
+	int failed = 0;
+
+	for (NNKernelSet set = NNKernelSetSSE2; set <= NNKernelSetAVX2; set++) {
+		NNKernels const *kernels = NNGetKernels(set);
+		if (kernels == NULL) {
+			printf("%s: not supported\n", setName[set]);
+			continue;
+		}
+		double err = compare(kernels, ref);
+		printf("%s: max error %g\n", setName[set], err);
+		if (err > ERRORMAX) {
+			printf("Error too large\n");
+			failed = 1;
+		}
+	}
+
+	return failed;
+}
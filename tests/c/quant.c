@@ -0,0 +1,123 @@
+/*
+    Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+    Miniature Mobile Robots group, Switzerland
+    Author: Yves Piguet
+
+    Licensed under the 3-Clause BSD License;
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    https://opensource.org/licenses/BSD-3-Clause
+*/
+
+// test of int8 nn: comparison with floating-point evaluation
+
+#include "nn/nn.h"
+#include "nn/nn-quant.h"
+#include "nn/nn-alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define EVALCOUNT 10000
+
+// maximum error accepted, relative to the range of outputs
+#define ERRORMAX 2e-2
+
+// compare outputs of nn and of its int8 version for random inputs in
+// [-inputMax, inputMax], and return the maximum error relative to
+// max(1, largest output)
+static double compare(NN *nn, NNFloat inputMax) {
+	NNQuant qnn;
+	void *quantMem = NULL;
+	double errMax = 0;
+	double outputMax = 1;
+
+	if (!NNQuantAllocStorage(nn, &quantMem)) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	NNQuantConvert(&qnn, nn, quantMem);
+
+	NNFloat *nnInput = NNGetInputPtr(nn);
+	NNFloat *nnOutput = NNGetOutputPtr(nn);
+	NNFloat *qnnInput = NNQuantGetInputPtr(&qnn);
+	NNFloat *qnnOutput = NNQuantGetOutputPtr(&qnn);
+	for (int n = 0; n < EVALCOUNT; n++) {
+		for (int i = 0; i < nn->inputCount; i++) {
+			nnInput[i] = qnnInput[i] = (2.0 * rand() / RAND_MAX - 1) * inputMax;
+		}
+		NNEval(nn, NULL);
+		NNQuantEval(&qnn);
+		for (int i = 0; i < nn->outputCount; i++) {
+			double err = fabs(nnOutput[i] - qnnOutput[i]);
+			if (err > errMax) {
+				errMax = err;
+			}
+			if (fabs(nnOutput[i]) > outputMax) {
+				outputMax = fabs(nnOutput[i]);
+			}
+		}
+	}
+
+	if (NNQuantWeightMemorySize(&qnn) * 4 != NNWeightMemorySize(nn)) {
+		printf("Unexpected memory size of weights\n");
+		errMax = HUGE_VAL;
+	}
+
+	NNQuantAllocStorage(NULL, &quantMem);
+	return errMax / outputMax;
+}
+
+static int test(char const *name, int inputCount,
+	int layerCount, int const *outputCount, NNActivation const *activation,
+	NNFloat inputMax) {
+	NN nn = { 0, 0, 0, 0, 0 };   // empty
+
+	NNReset(&nn, layerCount);
+	for (int k = 0; k < layerCount; k++) {
+		NNAddLayer(&nn, k == 0 ? inputCount : outputCount[k - 1], outputCount[k],
+			activation[k]);
+	}
+	NNInitWeights(&nn);
+	// scale first layer for inputs in [-inputMax, inputMax]
+	for (int i = 0; i < nn.layer[0].inputCount * nn.layer[0].outputCount; i++) {
+		nn.layer[0].W[i] /= inputMax;
+	}
+	for (int k = 0; k < layerCount; k++) {
+		for (int i = 0; i < nn.layer[k].outputCount; i++) {
+			nn.layer[k].B[i] = 0.5 * rand() / RAND_MAX - 0.25;
+		}
+	}
+
+	double err = compare(&nn, inputMax);
+	printf("%-24s max error: %.2e%s\n", name, err, err > ERRORMAX ? " (failure)" : "");
+	NNReset(&nn, 0);
+	return err <= ERRORMAX;
+}
+
+int main() {
+	int ok = 1;
+
+	{
+		int outputCount[] = {3, 1};
+		NNActivation activation[] = {NNActivationTanh, NNActivationTanh};
+		ok &= test("2-3-1 tanh", 2, 2, outputCount, activation, 1);
+	}
+	{
+		int outputCount[] = {16, 4};
+		NNActivation activation[] = {NNActivationTanh, NNActivationSigmoid};
+		ok &= test("7-16-4 sigmoid, sensors", 7, 2, outputCount, activation, 4500);
+	}
+	{
+		int outputCount[] = {20, 10, 2};
+		NNActivation activation[] = {NNActivationTanh, NNActivationTanh, NNActivationIdentity};
+		ok &= test("9-20-10-2 identity", 9, 3, outputCount, activation, 100);
+	}
+	{
+		int outputCount[] = {64, 8};
+		NNActivation activation[] = {NNActivationTanh, NNActivationIdentity};
+		ok &= test("256-64-8 identity", 256, 2, outputCount, activation, 1);
+	}
+
+	return ok ? 0 : 1;
+}
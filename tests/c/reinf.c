@@ -75,7 +75,7 @@ int main() {
 		NNAddLayer(&nn, nnSize[k], nnSize[k + 1], NNActivationIdentity);
 	}
 
-	NNObservations obs;
+	NNObservations obs = { 0, 0, 0, 0, 0 };	// empty
 	NNFloat *input, *output;
 	int status = NNObservationsInit(&obs, nn.inputCount, nn.outputCount, 10);
 	// no obstacle: fast forward
@@ -0,0 +1,150 @@
+/*
+    Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+    Miniature Mobile Robots group, Switzerland
+    Author: Yves Piguet
+
+    Licensed under the 3-Clause BSD License;
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    https://opensource.org/licenses/BSD-3-Clause
+*/
+
+// test of sparse layers: pruned dense network compared with its sparse
+// version, with memory saved and speedup
+// (build with optimizations for meaningful timing, e.g.
+// make CFLAGS="-O2 -I." test-nn-sparse)
+
+#include "nn/nn.h"
+#include "nn/nn-alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#define EVALCOUNT 2000
+
+// maximum error accepted (different order of summation)
+#define ERRORMAX 1e-5
+
+static double now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+// evaluate nn EVALCOUNT times and return the time
+static double benchEval(NN *nn) {
+	NNFloat *nnInput = NNGetInputPtr(nn);
+	double t0 = now();
+	for (int n = 0; n < EVALCOUNT; n++) {
+		for (int i = 0; i < nn->inputCount; i++) {
+			nnInput[i] = (NNFloat)((n + i) % 11) / 11 - 0.5;
+		}
+		NNEval(nn, NULL);
+	}
+	return now() - t0;
+}
+
+// compare outputs of pruned nn and its sparse version for random inputs
+// with NNEval and NNEvalBatch, and return the maximum error
+static double compare(NN *nn, NN *nnSparse) {
+	NNFloat input[16][256];
+	NNFloat output[16][64];
+	double errMax = 0;
+
+	NNFloat *nnInput = NNGetInputPtr(nn);
+	NNFloat *nnOutput = NNGetOutputPtr(nn);
+	NNFloat *nnSparseInput = NNGetInputPtr(nnSparse);
+	NNFloat *nnSparseOutput = NNGetOutputPtr(nnSparse);
+	void *batchTempMem = malloc(NNEvalBatchTempMemorySize(nnSparse, 16));
+	NNFloat **Y = NNEvalBatchInit(nnSparse, 16, batchTempMem);
+
+	for (int b = 0; b < 16; b++) {
+		for (int i = 0; i < nn->inputCount; i++) {
+			input[b][i] = 2.0 * rand() / RAND_MAX - 1;
+		}
+	}
+	NNEvalBatch(nnSparse, &input[0][0], 256, 16, &output[0][0], 64, Y);
+
+	for (int b = 0; b < 16; b++) {
+		for (int i = 0; i < nn->inputCount; i++) {
+			nnInput[i] = nnSparseInput[i] = input[b][i];
+		}
+		NNEval(nn, NULL);
+		NNEval(nnSparse, NULL);
+		for (int i = 0; i < nn->outputCount; i++) {
+			double err = fabs(nnOutput[i] - nnSparseOutput[i]);
+			if (err > errMax) {
+				errMax = err;
+			}
+			err = fabs(nnOutput[i] - output[b][i]);
+			if (err > errMax) {
+				errMax = err;
+			}
+		}
+	}
+
+	free(batchTempMem);
+	return errMax;
+}
+
+int main() {
+	NN nn = { 0, 0, 0, 0, 0 };   // empty
+	NN nnSparse = { 0, 0, 0, 0, 0 };   // empty
+	int size[] = {256, 128, 64, 8};
+	int layerCount = sizeof(size) / sizeof(int) - 1;
+	NNFloat thresholds[] = {0, 0.02, 0.05, 0.06, 0.08};
+	int failed = 0;
+
+	NNReset(&nn, layerCount);
+	for (int k = 0; k < layerCount; k++) {
+		NNAddLayer(&nn, size[k], size[k + 1], NNActivationTanh);
+	}
+	NNSeed(&nn, 1);
+	NNInitWeights(&nn);
+
+	int weightCount = NNLayerNonZeroCount(&nn.layer[0])
+		+ NNLayerNonZeroCount(&nn.layer[1]) + NNLayerNonZeroCount(&nn.layer[2]);
+	int denseSize = NNWeightMemorySize(&nn);
+	double tDense = benchEval(&nn);
+
+	printf("%-10s%12s%14s%12s%10s%10s\n",
+		"threshold", "nonzero", "weight bytes", "saved", "speedup", "error");
+	for (int t = 0; t < sizeof(thresholds) / sizeof(NNFloat); t++) {
+		int nonZeroCount = NNPrune(&nn, thresholds[t]);
+		if (!NNSparseConvert(&nnSparse, &nn)) {
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+		int sparseSize = NNWeightMemorySize(&nnSparse);
+		double tSparse = benchEval(&nnSparse);
+		double err = compare(&nn, &nnSparse);
+		printf("%-10g%11.1f%%%14d%11.1f%%%9.2fx%10.2g\n",
+			thresholds[t], 100.0 * nonZeroCount / weightCount, sparseSize,
+			100.0 * (denseSize - sparseSize) / denseSize, tDense / tSparse, err);
+		if (err > ERRORMAX) {
+			failed = 1;
+		}
+	}
+
+	// sparse layers are for evaluation only
+	void *backpropTempMem = NULL;
+	NNBackProp bp;
+	if (NNHasSparseLayer(&nnSparse)
+		&& NNBackPropAllocStorage(&nnSparse, &backpropTempMem)
+		&& NNBackPropInit(&nnSparse, &bp, backpropTempMem)) {
+		printf("Backprop initialized for sparse layers\n");
+		NNBackPropAllocStorage(NULL, &backpropTempMem);
+		return 1;
+	}
+	NNBackPropAllocStorage(NULL, &backpropTempMem);
+
+	NNReset(&nnSparse, 0);
+	NNReset(&nn, 0);
+
+	if (failed) {
+		printf("Error larger than %g\n", ERRORMAX);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,207 @@
+/*
+    Copyright 2022 ECOLE POLYTECHNIQUE FEDERALE DE LAUSANNE,
+    Miniature Mobile Robots group, Switzerland
+    Author: Yves Piguet
+
+    Licensed under the 3-Clause BSD License;
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    https://opensource.org/licenses/BSD-3-Clause
+*/
+
+// test of StaticNN: evaluation and backprop compared with NN, load and save
+// (build with optimizations for meaningful timing, e.g.
+// make CFLAGS="-O2 -I." CXXFLAGS="-O2 -I." test-nn-static)
+
+#include "nn/nn.h"
+#include "nn/nn-static.h"
+#include "nn/nn-alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#define EVALCOUNT 100000
+#define TRAINCOUNT 2000
+
+// maximum error accepted (different order of summation)
+#define ERRORMAX 1e-4
+
+using namespace nnstatic;
+
+static double now() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+// create nn with the topology of S and random weights and offsets
+template <typename S>
+static void initNN(NN *nn, int const *size, NNActivation const *activation) {
+	NNReset(nn, S::layerCount);
+	for (int k = 0; k < S::layerCount; k++) {
+		NNAddLayer(nn, size[k], size[k + 1], activation[k]);
+	}
+	NNSetAccuracy(nn, NNAccuracyExact);
+	NNInitWeights(nn);
+	for (int k = 0; k < S::layerCount; k++) {
+		for (int i = 0; i < nn->layer[k].outputCount; i++) {
+			nn->layer[k].B[i] = 0.5 * rand() / RAND_MAX - 0.25;
+		}
+	}
+}
+
+// maximum difference between weights and offsets of nn and s
+template <typename S>
+static double compareWeights(NN *nn, S const &s) {
+	NN nnCopy = { 0, 0, 0, 0, 0 };   // empty
+	int size[S::layerCount + 1];
+	NNActivation activation[S::layerCount];
+	size[0] = nn->inputCount;
+	for (int k = 0; k < S::layerCount; k++) {
+		size[k + 1] = nn->layer[k].outputCount;
+		activation[k] = nn->layer[k].activation;
+	}
+	initNN<S>(&nnCopy, size, activation);
+	s.save(&nnCopy);
+	double errMax = 0;
+	for (int k = 0; k < S::layerCount; k++) {
+		NNLayer const *layer = &nn->layer[k];
+		for (int i = 0; i < layer->inputCount * layer->outputCount; i++) {
+			errMax = fmax(errMax, fabs(layer->W[i] - nnCopy.layer[k].W[i]));
+		}
+		for (int i = 0; i < layer->outputCount; i++) {
+			errMax = fmax(errMax, fabs(layer->B[i] - nnCopy.layer[k].B[i]));
+		}
+	}
+	NNReset(&nnCopy, 0);
+	return errMax;
+}
+
+// compare evaluation and training of S and NN with the same topology
+template <typename S>
+static int test(char const *name, int const *size, NNActivation const *activation) {
+	NN nn = { 0, 0, 0, 0, 0 };   // empty
+	static S s;
+	static typename S::BackProp sbp;
+
+	initNN<S>(&nn, size, activation);
+	if (!s.load(&nn)) {
+		printf("%-20s load failed\n", name);
+		NNReset(&nn, 0);
+		return 0;
+	}
+
+	// evaluation
+	NNFloat *nnInput = NNGetInputPtr(&nn);
+	NNFloat *nnOutput = NNGetOutputPtr(&nn);
+	double errEval = 0;
+	for (int n = 0; n < 1000; n++) {
+		for (int i = 0; i < S::inputCount; i++) {
+			nnInput[i] = s.input()[i] = 2.0 * rand() / RAND_MAX - 1;
+		}
+		NNEval(&nn, NULL);
+		s.eval();
+		for (int i = 0; i < S::outputCount; i++) {
+			errEval = fmax(errEval, fabs(nnOutput[i] - s.output()[i]));
+		}
+	}
+
+	// outputs are summed to a volatile variable so that no evaluation is
+	// optimized out
+	static volatile NNFloat sum;
+	double t0 = now();
+	for (int n = 0; n < EVALCOUNT; n++) {
+		nnInput[0] = (NNFloat)(n % 11) / 11 - 0.5;
+		NNEval(&nn, NULL);
+		sum += nnOutput[0];
+	}
+	double t1 = now();
+	for (int n = 0; n < EVALCOUNT; n++) {
+		s.input()[0] = (NNFloat)(n % 11) / 11 - 0.5;
+		s.eval();
+		sum += s.output()[0];
+	}
+	double t2 = now();
+
+	// training with one observation per step: inputs and outputs in [-0.5,0.5]
+	void *bpTempMem = NULL;
+	NNBackProp bp;
+	if (!NNBackPropAllocStorage(&nn, &bpTempMem)) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+	NNBackPropInit(&nn, &bp, bpTempMem);
+	NNFloat expected[S::outputCount];
+	for (int n = 0; n < TRAINCOUNT; n++) {
+		for (int i = 0; i < S::inputCount; i++) {
+			nnInput[i] = s.input()[i] = (NNFloat)((n + i) % 7) / 7 - 0.5;
+		}
+		for (int i = 0; i < S::outputCount; i++) {
+			expected[i] = (NNFloat)((n * (i + 1)) % 5) / 5 - 0.5;
+		}
+		NNEval(&nn, NULL);
+		NNBackPropResetGradients(&nn, &bp);
+		NNBackPropAddGradientsAfterEval(&nn, &bp, expected);
+		NNBackPropApply(&nn, &bp, 0.01);
+		s.eval();
+		S::resetGradients(sbp);
+		s.addGradients(sbp, expected);
+		s.apply(sbp, 0.01);
+	}
+	NNBackPropAllocStorage(NULL, &bpTempMem);
+	double errTrain = compareWeights(&nn, s);
+
+	int ok = errEval <= ERRORMAX && errTrain <= ERRORMAX;
+	printf("%-20s%8d%8d%12.2g%12.2g%9.2fx%s\n",
+		name, (int)S::memorySize, NNArenaSize(S::layerCount, size),
+		errEval, errTrain, (t1 - t0) / (t2 - t1), ok ? "" : " (failure)");
+	NNReset(&nn, 0);
+	return ok;
+}
+
+int main() {
+	int ok = 1;
+
+	printf("%-20s%8s%8s%12s%12s%10s\n",
+		"network", "bytes", "arena", "eval error", "bp error", "speedup");
+	{
+		typedef StaticNN<2, Layer<3, Tanh>, Layer<1, Tanh>> S;
+		static_assert(sizeof(S) == S::memorySize, "unexpected size");
+		static_assert(sizeof(S::BackProp) == S::BackProp::memorySize,
+			"unexpected size");
+		int size[] = {2, 3, 1};
+		NNActivation activation[] = {Tanh, Tanh};
+		ok &= test<S>("2-3-1 tanh", size, activation);
+	}
+	{
+		typedef StaticNN<7, Layer<16, Tanh>, Layer<4, Sigmoid>> S;
+		static_assert(sizeof(S) == S::memorySize, "unexpected size");
+		int size[] = {7, 16, 4};
+		NNActivation activation[] = {Tanh, Sigmoid};
+		ok &= test<S>("7-16-4 sigmoid", size, activation);
+	}
+	{
+		typedef StaticNN<9, Layer<20, Tanh>, Layer<10, Tanh>, Layer<2, Identity>> S;
+		static_assert(sizeof(S) == S::memorySize, "unexpected size");
+		int size[] = {9, 20, 10, 2};
+		NNActivation activation[] = {Tanh, Tanh, Identity};
+		ok &= test<S>("9-20-10-2 identity", size, activation);
+	}
+	{
+		// different topology
+		typedef StaticNN<2, Layer<3, Tanh>, Layer<1, Tanh>> S;
+		static S s;
+		NN nn = { 0, 0, 0, 0, 0 };   // empty
+		int size[] = {2, 3, 1};
+		NNActivation activation[] = {Tanh, Sigmoid};
+		initNN<S>(&nn, size, activation);
+		if (s.load(&nn) || s.save(&nn)) {
+			printf("Load or save with different topology\n");
+			ok = 0;
+		}
+		NNReset(&nn, 0);
+	}
+
+	return ok ? 0 : 1;
+}
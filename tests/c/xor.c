@@ -14,6 +14,7 @@
 #include "nn/nn.h"
 #include "nn/nn-alloc.h"
 #include <stdio.h>
+#include <string.h>
 
 static void step(NN *nn, NNBackProp *bp, NNFloat const *input, NNFloat const *output, NNFloat eta) {
 	NNFloat *nnInput = NNGetInputPtr(nn);
@@ -49,7 +50,7 @@ static void step(NN *nn, NNBackProp *bp, NNFloat const *input, NNFloat const *ou
 
 int main() {
 	NN nn = { 0, 0, 0, 0, 0 };   // empty
-	NNBackProp bp = { 0, 0, 0, 0, 0, 0 };	// empty
+	NNBackProp bp = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };	// empty
 	int nnSize[] = {2, 3, 1};
 	NNActivation activation = NNActivationTanh;
 	int nnLayerCount = sizeof(nnSize) / sizeof(int) - 1;
@@ -97,4 +98,44 @@ int main() {
 		output[0] = 0;
 		step(&nn, &bp, input, output, eta);
 	}
+
+	// second pass: same network in an arena, copied with a single memcpy
+	NN nnArena = { 0, 0, 0, 0, 0 };   // empty
+	NN nnCopy = { 0, 0, 0, 0, 0 };   // empty
+	if (!NNResetArena(&nnArena, nnLayerCount, nnSize)
+		|| !NNResetArena(&nnCopy, nnLayerCount, nnSize)) {
+		printf("Arena allocation failed\n");
+		return 1;
+	}
+	for (int k = 0; k < nnLayerCount; k++) {
+		NNAddLayer(&nnArena, nnSize[k], nnSize[k + 1], activation);
+		NNAddLayer(&nnCopy, nnSize[k], nnSize[k + 1], activation);
+		memcpy(nnArena.layer[k].W, nn.layer[k].W,
+			nnSize[k] * nnSize[k + 1] * sizeof(NNFloat));
+		memcpy(nnArena.layer[k].B, nn.layer[k].B, nnSize[k + 1] * sizeof(NNFloat));
+	}
+	NNFloat *nnInput = NNGetInputPtr(&nn);
+	nnInput[0] = 1;
+	nnInput[1] = 0;
+	NNGetInputPtr(&nnArena)[0] = nnInput[0];
+	NNGetInputPtr(&nnArena)[1] = nnInput[1];
+	NNEval(&nn, NULL);
+	NNEval(&nnArena, NULL);
+	if (!NNArenaCopy(&nnCopy, &nnArena)) {
+		printf("Copy failed\n");
+		return 1;
+	}
+	NNEval(&nnCopy, NULL);
+	for (int i = 0; i < nn.outputCount; i++) {
+		if (NNGetOutputPtr(&nnArena)[i] != NNGetOutputPtr(&nn)[i]
+			|| NNGetOutputPtr(&nnCopy)[i] != NNGetOutputPtr(&nn)[i]) {
+			printf("Arena network differs from original\n");
+			return 1;
+		}
+	}
+
+	NNReset(&nnCopy, 0);
+	NNReset(&nnArena, 0);
+	NNReset(&nn, 0);
+	return 0;
 }
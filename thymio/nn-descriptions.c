@@ -16,7 +16,7 @@
 
 AsebaNativeFunctionDescription NNNativeDescription_nngeterror = {
 	"nn.geterror",
-	"Get last error when calling an nn function (0=ok, 1=out-of-mem, 2=no nn, 3=index out of range, 4=unsuitable for hebbian rule)",
+	"Get last error when calling an nn function (0=ok, 1=out-of-mem, 2=no nn, 3=index out of range, 4=unsuitable for hebbian rule, 5=dataset size exceeded, 6=no fixed-point nn, 7=sparse layer, 8=no training started)",
 	{
 		{1, "error"},
 		{0, NULL}
@@ -253,3 +253,197 @@ AsebaNativeFunctionDescription NNNativeDescription_nnbackpropdataset = {
 		{0, NULL}
 	}
 };
+
+AsebaNativeFunctionDescription NNNativeDescription_nnbackpropbatch = {
+	"nn.backprop.batch",
+	"Use dataset to learn with back-propagation of the mean gradient of mini-batches",
+	{
+		{1, "etanum"},
+		{1, "etaden"},
+		{1, "number of iterations over the whole dataset"},
+		{1, "number of observations per batch"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nnfixedinit = {
+	"nn.fixed.init",
+	"Convert neural network to fixed point for nn.fixed.eval",
+	{
+		{1, "maximum absolute value of inputs"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nnfixedeval = {
+	"nn.fixed.eval",
+	"Evaluate fixed-point neural network without floating-point arithmetic",
+	{
+		{-1, "inputs"},
+		{-2, "outputs"},
+		{1, "number of fractional bits of outputs"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nnsetaccuracy = {
+	"nn.setaccuracy",
+	"Set accuracy of tanh and sigmoid",
+	{
+		{1, "accuracy (0=exact, 1=rational approximation, 2=table)"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nnsetoptimizer = {
+	"nn.setoptimizer",
+	"Set optimizer used by back-propagation",
+	{
+		{1, "optimizer (0=SGD, 1=momentum, 2=RMSProp, 3=Adam)"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nnprune = {
+	"nn.prune",
+	"Remove small weights and store sparse layers, which cannot be trained anymore",
+	{
+		{1, "thresholdnum"},
+		{1, "thresholdden"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nnselect = {
+	"nn.select",
+	"Select the neural network used by all other functions, each with its own weights, dataset and memory",
+	{
+		{1, "index (0 to 3)"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nngetweightsscaled = {
+	"nn.getweights.scaled",
+	"Get weights of a layer as w * 2^-exponent, with the exponent chosen for the largest weight",
+	{
+		{1, "layerindex"},
+		{-1, "w"},
+		{1, "exponent"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nnsetweightsscaled = {
+	"nn.setweights.scaled",
+	"Set weights of a layer to w * 2^-exponent",
+	{
+		{1, "layerindex"},
+		{-1, "w"},
+		{1, "exponent"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nngetoffsetsscaled = {
+	"nn.getoffsets.scaled",
+	"Get offsets of a layer as b * 2^-exponent, with the exponent chosen for the largest offset",
+	{
+		{1, "layerindex"},
+		{-1, "b"},
+		{1, "exponent"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nnsetoffsetsscaled = {
+	"nn.setoffsets.scaled",
+	"Set offsets of a layer to b * 2^-exponent",
+	{
+		{1, "layerindex"},
+		{-1, "b"},
+		{1, "exponent"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nnsetinputsscaled = {
+	"nn.setinputs.scaled",
+	"Set inputs to inputs * 2^-exponent",
+	{
+		{-1, "inputs"},
+		{1, "exponent"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nngetoutputsscaled = {
+	"nn.getoutputs.scaled",
+	"Get outputs multiplied by 2^exponent (e.g. 14 for tanh, 15 for sigmoid)",
+	{
+		{-1, "outputs"},
+		{1, "exponent"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nnsetoutputsscaled = {
+	"nn.setoutputs.scaled",
+	"Set outputs (expected outputs for nn.backprop) to outputs * 2^-exponent",
+	{
+		{-1, "outputs"},
+		{1, "exponent"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nntrainstart = {
+	"nn.train.start",
+	"Start training with dataset and back-propagation, performed by calls of nn.train.step",
+	{
+		{1, "etanum"},
+		{1, "etaden"},
+		{1, "number of iterations over the whole dataset"},
+		{1, "number of observations per batch"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nntrainstep = {
+	"nn.train.step",
+	"Continue training started by nn.train.start for a limited number of observations",
+	{
+		{1, "maximum number of observations"},
+		{1, "progress (percentage)"},
+		{1, "mean cost of last iteration num (-1 if none)"},
+		{1, "mean cost of last iteration den"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nndatasetring = {
+	"nn.dataset.ring",
+	"Set ring mode of dataset, where nn.dataset.add replaces the oldest observation when the dataset is full",
+	{
+		{1, "enable (0=no, 1=yes)"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nntrainsampling = {
+	"nn.train.sampling",
+	"Set choice of observations for nn.train.step",
+	{
+		{1, "sampling (0=all in order, 1=uniform, 2=by priority from last cost, 3=all shuffled)"},
+		{0, NULL}
+	}
+};
+
+AsebaNativeFunctionDescription NNNativeDescription_nnseed = {
+	"nn.seed",
+	"Set seed of pseudorandom numbers used by nn.init, nn.reset and nn.train.step",
+	{
+		{1, "seed"},
+		{0, NULL}
+	}
+};
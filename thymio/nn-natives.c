@@ -13,24 +13,71 @@
 #include "common/consts.h"
 
 #include "../nn/nn.h"
+#include "../nn/nn-fixed.h"
 #include "../nn/nn-alloc.h"
 #include <math.h>
 
-// single neural network
-
-static NN nn = { 0, 0, 0, 0, 0 };   // empty
-static NNBackProp bp = { 0, 0, 0, 0, 0, 0 };	// empty
-static NNObservations obs = { 0, 0, 0, 0, 0 };	// empty
-static void *backpropTempMem = 0;
+// number of neural networks which can be used at the same time
+#if !defined(NNHandleCount)
+#	define NNHandleCount 4
+#endif
+
+// maximum memory (bytes) of the network and dataset of each handle, so that
+// a handle cannot take the memory needed by the others
+#if !defined(NNHandleMemoryMax)
+#	define NNHandleMemoryMax 32768
+#endif
+
+// maximum number of layers of a network created by nn.init
+#if !defined(NNLayerCountMax)
+#	define NNLayerCountMax 16
+#endif
+
+// neural network with its own data and memory, selected by nn.select
+typedef struct {
+	NN nn;
+	NNBackProp bp;
+	NNObservations obs;
+	void *backpropTempMem;
+	int backpropReady;	// backpropTempMem allocated and bp initialized for nn
+	NNTraining training;	// state of nn.train.step
+	NNSampling sampling;	// sampling used by nn.train.start
+	NNFixed fnn;	// fixed-point version of nn
+	void *fixedMem;
+} NNHandle;
+
+static NNHandle handle[NNHandleCount];	// all empty (zero-initialized)
+static NNHandle *current = &handle[0];	// network used by all other natives
 static enum {
 	NNErrorOk = 0,
 	NNErrorOutOfMemory,
 	NNErrorNoNN,
 	NNErrorIndexOutOfRange,
 	NNErrorUnsuitableForHebbianRule,
-	NNErrorDatasetSizeExceeded
+	NNErrorDatasetSizeExceeded,
+	NNErrorNoFixedNN,
+	NNErrorSparseLayer,
+	NNErrorNoTraining
 } error = 0;
 
+// number of consecutive steps of the Farey search which replace (p, q) by
+// (p + dp, q + dq), i.e. the largest k <= kMax such that x is on the side
+// given by right of the mediants (p + (i+1) dp) / (q + (i+1) dq) for i < k
+static int fareySteps(NNFloat x, int p, int q, int dp, int dq, int kMax, int right) {
+	// first i in [lo, hi] where the mediant is not strictly on the side of x
+	int lo = 0, hi = kMax;
+	while (lo < hi) {
+		int i = (lo + hi) / 2;
+		NNFloat m = (NNFloat)(p + (i + 1) * dp) / (q + (i + 1) * dq);
+		if (right ? x > m : x < m) {
+			lo = i + 1;
+		} else {
+			hi = i;
+		}
+	}
+	return lo;
+}
+
 static void fractionApprox(NNFloat x, int16_t *num, int16_t *den) {
 
 	const int max = 0x7fff;
@@ -45,7 +92,7 @@ static void fractionApprox(NNFloat x, int16_t *num, int16_t *den) {
 		return;
 	}
 
-	// approx
+	// approx, with consecutive steps in the same direction done at once
 	while (b <= max && d <= max) {
 		NNFloat m = (NNFloat)(a + c) / (b + d);
 		if (x == m) {
@@ -57,11 +104,13 @@ static void fractionApprox(NNFloat x, int16_t *num, int16_t *den) {
 				break;
 			}
 		} else if (x > m) {
-			a += c;
-			b += d;
+			int k = fareySteps(x, a, b, c, d, (max - b) / d + 1, 1);
+			a += k * c;
+			b += k * d;
 		} else {
-			c += a;
-			d += b;
+			int k = fareySteps(x, c, d, a, b, (max - d) / b + 1, 0);
+			c += k * a;
+			d += k * b;
 		}
 	}
 
@@ -74,6 +123,88 @@ static void fractionApprox(NNFloat x, int16_t *num, int16_t *den) {
 	}
 }
 
+// exponent e such that round(x[i] * 2^e) fits in int16 for i = 0..n-1 with
+// the largest precision (between -15 and 30)
+static int scaledExponent(NNFloat const *x, int n) {
+	NNFloat xMax = 0;
+	for (int i = 0; i < n; i++) {
+		if (fabs(x[i]) > xMax) {
+			xMax = fabs(x[i]);
+		}
+	}
+	if (xMax == 0) {
+		return 0;
+	}
+	int e;
+	frexp(xMax, &e);	// 2^(e-1) <= xMax < 2^e
+	e = 15 - e;
+	if (round(ldexp(xMax, e)) > 32767) {
+		e--;
+	}
+	return e < -15 ? -15 : e > 30 ? 30 : e;
+}
+
+// v[i] = round(x[i] * 2^e) with saturation
+static void toScaled(int16_t *v, NNFloat const *x, int n, int e) {
+	for (int i = 0; i < n; i++) {
+		NNFloat y = round(ldexp(x[i], e));
+		v[i] = y > 32767 ? 32767 : y < -32768 ? -32768 : (int16_t)y;
+	}
+}
+
+// x[i] = v[i] * 2^-e
+static void fromScaled(NNFloat *x, int16_t const *v, int n, int e) {
+	for (int i = 0; i < n; i++) {
+		x[i] = ldexp(v[i], -e);
+	}
+}
+
+// allocate and initialize backprop memory of the current network the first
+// time it is needed, returning 1 for success or 0 if out of memory, so that
+// training steps do not allocate anything
+static int backPropPrepare(void) {
+	if (!current->backpropReady) {
+		if (!NNBackPropAllocStorage(&current->nn, &current->backpropTempMem)
+			|| !NNBackPropInit(&current->nn, &current->bp, current->backpropTempMem)) {
+			return 0;
+		}
+		current->backpropReady = 1;
+	}
+	return 1;
+}
+
+// free backprop memory of the current network, whose size depends on its
+// topology and optimizer
+static void backPropFree(void) {
+	NNBackPropAllocStorage(NULL, &current->backpropTempMem);
+	current->backpropReady = 0;
+}
+
+// memory (bytes) of a dataset of maxCount observations
+static long datasetMemorySize(int inputCount, int outputCount, int maxCount) {
+	return (long)(inputCount + outputCount + 1) * maxCount * sizeof(NNFloat);
+}
+
+// memory (bytes) of a network, in an arena (nn.init) or not (sparse copy
+// made by nn.prune)
+static long networkMemorySize(NN const *nn) {
+	if (nn->arena) {
+		return nn->arenaSize;
+	}
+	long size = nn->layerCount * sizeof(NNLayer) + NNWeightMemorySize(nn)
+		+ nn->inputCount * sizeof(NNFloat);
+	for (int k = 0; k < nn->layerCount; k++) {
+		size += 2 * nn->layer[k].outputCount * sizeof(NNFloat);	// B, output
+	}
+	return size;
+}
+
+// free fixed-point network converted from weights which have changed
+static void fixedFree(void) {
+	NNFixedAllocStorage(NULL, &current->fixedMem);
+	current->fnn.layerCount = 0;
+}
+
 // nn.geterror(e)
 void NN_nngeterror(AsebaVMState *vm) {
 	int16_t *e = &vm->variables[AsebaNativePopArg(vm)];
@@ -92,12 +223,31 @@ void NN_nninit(AsebaVMState *vm) {
 	uint16_t const activationCodeAddr = AsebaNativePopArg(vm);
 	uint16_t const layerCount = AsebaNativePopArg(vm);
 
-	if (!NNReset(&nn, layerCount)) {
+	backPropFree();
+	fixedFree();
+	current->training.obs = NULL;
+
+	if (layerCount > NNLayerCountMax) {
+		error = NNErrorIndexOutOfRange;
+		return;
+	}
+	int size[NNLayerCountMax + 1];
+	size[0] = inputCount;
+	for (int i = 0; i < layerCount; i++) {
+		size[i + 1] = vm->variables[outputCountAddr + i];
+		if ((long)size[i] * size[i + 1] > NNHandleMemoryMax) {
+			error = NNErrorOutOfMemory;
+			return;
+		}
+	}
+	if (NNArenaSize(layerCount, size) + datasetMemorySize(current->obs.inputCount,
+			current->obs.outputCount, current->obs.maxCount) > NNHandleMemoryMax
+		|| !NNResetArena(&current->nn, layerCount, size)) {
 		error = NNErrorOutOfMemory;
 		return;
 	}
 	for (int i = 0; i < layerCount; i++) {
-		if (!NNAddLayer(&nn,
+		if (!NNAddLayer(&current->nn,
 			i == 0 ? inputCount : vm->variables[outputCountAddr + i - 1],
 			vm->variables[outputCountAddr + i],
 			vm->variables[activationCodeAddr + i] == 1 ? NNActivationTanh
@@ -108,21 +258,95 @@ void NN_nninit(AsebaVMState *vm) {
 		}
 	}
 
-	NNInitWeights(&nn);
+	// networks of different handles get different weights unless seeded
+	uint32_t const *state = current->nn.random;
+	if ((state[0] | state[1] | state[2] | state[3]) == 0) {
+		NNSeed(&current->nn, current - handle);
+	}
+	NNInitWeights(&current->nn);
 }
 
 void NN_nnfree(AsebaVMState *vm) {
-	NNReset(&nn, 0);
-	NNBackPropAllocStorage(NULL, &backpropTempMem);
-	NNObservationsInit(&obs, 0, 0, 0);
+	NNReset(&current->nn, 0);
+	backPropFree();
+	fixedFree();
+	current->training.obs = NULL;
+	NNObservationsInit(&current->obs, 0, 0, 0);
+}
+
+// nn.select(index)
+void NN_nnselect(AsebaVMState *vm) {
+	int16_t const index = vm->variables[AsebaNativePopArg(vm)];
+
+	if (index >= 0 && index < NNHandleCount) {
+		current = &handle[index];
+	} else {
+		error = NNErrorIndexOutOfRange;
+	}
+}
+
+// nn.setaccuracy(accuracy)
+void NN_nnsetaccuracy(AsebaVMState *vm) {
+	int16_t const accuracy = vm->variables[AsebaNativePopArg(vm)];
+
+	NNSetAccuracy(&current->nn, accuracy == 1 ? NNAccuracyRational
+		: accuracy == 2 ? NNAccuracyTable
+		: NNAccuracyExact);
+}
+
+// nn.setoptimizer(optimizer)
+void NN_nnsetoptimizer(AsebaVMState *vm) {
+	int16_t const optimizer = vm->variables[AsebaNativePopArg(vm)];
+
+	NNSetOptimizer(&current->nn, optimizer == 1 ? NNOptimizerMomentum
+		: optimizer == 2 ? NNOptimizerRMSProp
+		: optimizer == 3 ? NNOptimizerAdam
+		: NNOptimizerSGD);
+	backPropFree();
+}
+
+// reset optimizer state, if any, for new weights
+static void backPropReset(void) {
+	if (current->backpropReady) {
+		NNBackPropInit(&current->nn, &current->bp, current->backpropTempMem);
+	}
 }
 
 void NN_nnreset(AsebaVMState *vm) {
-	NNInitWeights(&nn);
+	NNInitWeights(&current->nn);
+	backPropReset();
+	fixedFree();
 }
 
 void NN_nnclear(AsebaVMState *vm) {
-	NNClearWeights(&nn);
+	NNClearWeights(&current->nn);
+	backPropReset();
+	fixedFree();
+}
+
+// nn.prune(thresholdnum, thresholdden)
+void NN_nnprune(AsebaVMState *vm) {
+	int16_t const thresholdnum = vm->variables[AsebaNativePopArg(vm)];
+	int16_t const thresholdden = vm->variables[AsebaNativePopArg(vm)];
+	NN nnSparse = { 0, 0, 0, 0, 0 };   // empty
+
+	if (current->nn.layerCount == 0) {
+		error = NNErrorNoNN;
+	} else if (thresholdden <= 0) {
+		error = NNErrorIndexOutOfRange;
+	} else {
+		NNPrune(&current->nn, (NNFloat)thresholdnum / thresholdden);
+		fixedFree();
+		if (!NNSparseConvert(&nnSparse, &current->nn)) {
+			NNReset(&nnSparse, 0);
+			error = NNErrorOutOfMemory;
+		} else {
+			// replace nn, which cannot be trained anymore
+			NNReset(&current->nn, 0);
+			current->nn = nnSparse;
+			backPropFree();
+		}
+	}
 }
 
 // nn.getweight(layerIndex, inputIndex, outputIndex, num, den)
@@ -133,12 +357,15 @@ void NN_nngetweight(AsebaVMState *vm) {
 	int16_t *num = &vm->variables[AsebaNativePopArg(vm)];
 	int16_t *den = &vm->variables[AsebaNativePopArg(vm)];
 
-	if (nn.layerCount == 0) {
+	if (current->nn.layerCount == 0) {
 		error = NNErrorNoNN;
-	} else if (layerIndex >= 0 && layerIndex < nn.layerCount
-		&& inputIndex >= 0 && inputIndex < nn.layer[layerIndex].inputCount
-		&& outputIndex >= 0 && outputIndex < nn.layer[layerIndex].outputCount) {
-			NNLayer *layer = &nn.layer[layerIndex];
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount
+		&& !current->nn.layer[layerIndex].W) {
+		error = NNErrorSparseLayer;
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount
+		&& inputIndex >= 0 && inputIndex < current->nn.layer[layerIndex].inputCount
+		&& outputIndex >= 0 && outputIndex < current->nn.layer[layerIndex].outputCount) {
+			NNLayer *layer = &current->nn.layer[layerIndex];
 			fractionApprox(layer->W[outputIndex * layer->inputCount + inputIndex],
 				num, den);
 	} else {
@@ -154,13 +381,17 @@ void NN_nnsetweight(AsebaVMState *vm) {
 	const int16_t num = vm->variables[AsebaNativePopArg(vm)];
 	const int16_t den = vm->variables[AsebaNativePopArg(vm)];
 
-	if (nn.layerCount == 0) {
+	if (current->nn.layerCount == 0) {
 		error = NNErrorNoNN;
-	} else if (layerIndex >= 0 && layerIndex < nn.layerCount
-		&& inputIndex >= 0 && inputIndex < nn.layer[layerIndex].inputCount
-		&& outputIndex >= 0 && outputIndex < nn.layer[layerIndex].outputCount
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount
+		&& !current->nn.layer[layerIndex].W) {
+		error = NNErrorSparseLayer;
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount
+		&& inputIndex >= 0 && inputIndex < current->nn.layer[layerIndex].inputCount
+		&& outputIndex >= 0 && outputIndex < current->nn.layer[layerIndex].outputCount
 		&& den != 0) {
-			NNLayer *layer = &nn.layer[layerIndex];
+			NNLayer *layer = &current->nn.layer[layerIndex];
+			fixedFree();
 			layer->W[outputIndex * layer->inputCount + inputIndex] = (NNFloat)num / den;
 	} else {
 		error = NNErrorIndexOutOfRange;
@@ -174,10 +405,13 @@ void NN_nngetweights(AsebaVMState *vm) {
 	int16_t *den = &vm->variables[AsebaNativePopArg(vm)];
 	uint16_t const length = AsebaNativePopArg(vm);
 
-	if (nn.layerCount == 0) {
+	if (current->nn.layerCount == 0) {
 		error = NNErrorNoNN;
-	} else if (layerIndex >= 0 && layerIndex < nn.layerCount) {
-		NNLayer *layer = &nn.layer[layerIndex];
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount
+		&& !current->nn.layer[layerIndex].W) {
+		error = NNErrorSparseLayer;
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount) {
+		NNLayer *layer = &current->nn.layer[layerIndex];
 		for (int i = 0; i < length && i < layer->inputCount * layer->outputCount; i++) {
 			fractionApprox(layer->W[i], &num[i], &den[i]);
 		}
@@ -193,10 +427,14 @@ void NN_nnsetweights(AsebaVMState *vm) {
 	int16_t *den = &vm->variables[AsebaNativePopArg(vm)];
 	uint16_t const length = AsebaNativePopArg(vm);
 
-	if (nn.layerCount == 0) {
+	if (current->nn.layerCount == 0) {
 		error = NNErrorNoNN;
-	} else if (layerIndex >= 0 && layerIndex < nn.layerCount) {
-		NNLayer *layer = &nn.layer[layerIndex];
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount
+		&& !current->nn.layer[layerIndex].W) {
+		error = NNErrorSparseLayer;
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount) {
+		NNLayer *layer = &current->nn.layer[layerIndex];
+		fixedFree();
 		for (int i = 0; i < length && i < layer->inputCount * layer->outputCount; i++) {
 			layer->W[i] = (NNFloat)num[i] / den[i];
 		}
@@ -211,12 +449,13 @@ void NN_nnsetoffset(AsebaVMState *vm) {
 	const int16_t num = vm->variables[AsebaNativePopArg(vm)];
 	const int16_t den = vm->variables[AsebaNativePopArg(vm)];
 
-	if (nn.layerCount == 0) {
+	if (current->nn.layerCount == 0) {
 		error = NNErrorNoNN;
-	} else if (layerIndex >= 0 && layerIndex < nn.layerCount
-		&& index >= 0 && index < nn.layer[layerIndex].outputCount
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount
+		&& index >= 0 && index < current->nn.layer[layerIndex].outputCount
 		&& den != 0) {
-			NNLayer *layer = &nn.layer[layerIndex];
+			NNLayer *layer = &current->nn.layer[layerIndex];
+			fixedFree();
 			layer->B[index] = (NNFloat)num / den;
 	} else {
 		error = NNErrorIndexOutOfRange;
@@ -229,12 +468,12 @@ void NN_nngetoffset(AsebaVMState *vm) {
 	int16_t *num = &vm->variables[AsebaNativePopArg(vm)];
 	int16_t *den = &vm->variables[AsebaNativePopArg(vm)];
 
-	if (nn.layerCount == 0) {
+	if (current->nn.layerCount == 0) {
 		error = NNErrorNoNN;
-	} else if (layerIndex >= 0 && layerIndex < nn.layerCount
-		&& index >= 0 && index < nn.layer[layerIndex].outputCount
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount
+		&& index >= 0 && index < current->nn.layer[layerIndex].outputCount
 		&& den != 0) {
-			NNLayer *layer = &nn.layer[layerIndex];
+			NNLayer *layer = &current->nn.layer[layerIndex];
 			fractionApprox(layer->B[index], num, den);
 	} else {
 		error = NNErrorIndexOutOfRange;
@@ -248,10 +487,10 @@ void NN_nngetoffsets(AsebaVMState *vm) {
 	int16_t *den = &vm->variables[AsebaNativePopArg(vm)];
 	uint16_t const length = AsebaNativePopArg(vm);
 
-	if (nn.layerCount == 0) {
+	if (current->nn.layerCount == 0) {
 		error = NNErrorNoNN;
-	} else if (layerIndex >= 0 && layerIndex < nn.layerCount) {
-		NNLayer *layer = &nn.layer[layerIndex];
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount) {
+		NNLayer *layer = &current->nn.layer[layerIndex];
 		for (int i = 0; i < length && i < layer->outputCount; i++) {
 			fractionApprox(layer->B[i], &num[i], &den[i]);
 		}
@@ -267,10 +506,11 @@ void NN_nnsetoffsets(AsebaVMState *vm) {
 	int16_t *den = &vm->variables[AsebaNativePopArg(vm)];
 	uint16_t const length = AsebaNativePopArg(vm);
 
-	if (nn.layerCount == 0) {
+	if (current->nn.layerCount == 0) {
 		error = NNErrorNoNN;
-	} else if (layerIndex >= 0 && layerIndex < nn.layerCount) {
-		NNLayer *layer = &nn.layer[layerIndex];
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount) {
+		NNLayer *layer = &current->nn.layer[layerIndex];
+		fixedFree();
 		for (int i = 0; i < length && i < layer->outputCount; i++) {
 			layer->B[i] = (NNFloat)num[i] / den[i];
 		}
@@ -283,8 +523,8 @@ void NN_nngetinputs(AsebaVMState *vm) {
 	int16_t *inputs = &vm->variables[AsebaNativePopArg(vm)];
 	uint16_t const length = AsebaNativePopArg(vm);
 
-	if (nn.layerCount > 0) {
-		NNLayer *layer0 = &nn.layer[0];
+	if (current->nn.layerCount > 0) {
+		NNLayer *layer0 = &current->nn.layer[0];
 		for (int i = 0; i < layer0->inputCount && i < length; i++) {
 			inputs[i] = (int16_t)round(layer0->input[i]);
 		}
@@ -297,8 +537,8 @@ void NN_nnsetinputs(AsebaVMState *vm) {
 	int16_t *inputs = &vm->variables[AsebaNativePopArg(vm)];
 	uint16_t const length = AsebaNativePopArg(vm);
 
-	if (nn.layerCount > 0) {
-		NNLayer *layer0 = &nn.layer[0];
+	if (current->nn.layerCount > 0) {
+		NNLayer *layer0 = &current->nn.layer[0];
 		for (int i = 0; i < layer0->inputCount && i < length; i++) {
 			layer0->input[i] = (NNFloat)inputs[i];
 		}
@@ -311,8 +551,8 @@ void NN_nngetoutputs(AsebaVMState *vm) {
 	int16_t *outputs = &vm->variables[AsebaNativePopArg(vm)];
 	uint16_t const length = AsebaNativePopArg(vm);
 
-	if (nn.layerCount > 0) {
-		NNLayer *layerLast = &nn.layer[nn.layerCount - 1];
+	if (current->nn.layerCount > 0) {
+		NNLayer *layerLast = &current->nn.layer[current->nn.layerCount - 1];
 		for (int i = 0; i < layerLast->outputCount && i < length; i++) {
 			outputs[i] = (int16_t)round(layerLast->output[i]);
 		}
@@ -325,8 +565,8 @@ void NN_nnsetoutputs(AsebaVMState *vm) {
 	int16_t *outputs = &vm->variables[AsebaNativePopArg(vm)];
 	uint16_t const length = AsebaNativePopArg(vm);
 
-	if (nn.layerCount > 0) {
-		NNLayer *layerLast = &nn.layer[nn.layerCount - 1];
+	if (current->nn.layerCount > 0) {
+		NNLayer *layerLast = &current->nn.layer[current->nn.layerCount - 1];
 		for (int i = 0; i < layerLast->outputCount && i < length; i++) {
 			layerLast->output[i] = (NNFloat)outputs[i];
 		}
@@ -336,37 +576,91 @@ void NN_nnsetoutputs(AsebaVMState *vm) {
 }
 
 void NN_nneval(AsebaVMState *vm) {
-	NNEval(&nn, NULL);
+	NNEval(&current->nn, NULL);
+}
+
+// nn.fixed.init(inputMax)
+void NN_nnfixedinit(AsebaVMState *vm) {
+	int16_t const inputMax = vm->variables[AsebaNativePopArg(vm)];
+
+	if (current->nn.layerCount == 0) {
+		error = NNErrorNoNN;
+	} else if (NNHasSparseLayer(&current->nn)) {
+		error = NNErrorSparseLayer;
+	} else if (!NNFixedAllocStorage(&current->nn, &current->fixedMem)) {
+		current->fnn.layerCount = 0;
+		error = NNErrorOutOfMemory;
+	} else {
+		// integer inputs
+		NNFixedConvert(&current->fnn, &current->nn, current->fixedMem, 0, inputMax);
+	}
+}
+
+// nn.fixed.eval(inputs, outputs, outputShift)
+void NN_nnfixedeval(AsebaVMState *vm) {
+	int16_t *inputs = &vm->variables[AsebaNativePopArg(vm)];
+	int16_t *outputs = &vm->variables[AsebaNativePopArg(vm)];
+	int16_t const outputShift = vm->variables[AsebaNativePopArg(vm)];
+	uint16_t const inputLength = AsebaNativePopArg(vm);
+	uint16_t const outputLength = AsebaNativePopArg(vm);
+
+	if (current->fnn.layerCount == 0) {
+		error = NNErrorNoFixedNN;
+	} else if (inputLength < current->fnn.inputCount) {
+		error = NNErrorIndexOutOfRange;
+	} else {
+		NNFixedEval(&current->fnn, inputs);
+		int16_t const *fnnOutputs = NNFixedGetOutputPtr(&current->fnn);
+		int shift = current->fnn.layer[current->fnn.layerCount - 1].outputShift - outputShift;
+		for (int i = 0; i < current->fnn.outputCount && i < outputLength; i++) {
+			int32_t y = fnnOutputs[i];
+			y = shift >= 31 ? 0
+				: shift > 0 ? (y + (1 << (shift - 1))) >> shift
+				: y * (1 << (shift < -16 ? 16 : -shift));
+			outputs[i] = y > 32767 ? 32767 : y < -32768 ? -32768 : y;
+		}
+	}
 }
 
 void NN_nnhebbianrule(AsebaVMState *vm) {
-	if (nn.layerCount == 1 && nn.layer[0].activation == NNActivationIdentity) {
-		int16_t const alphanum = vm->variables[AsebaNativePopArg(vm)];
-		int16_t const alphaden = vm->variables[AsebaNativePopArg(vm)];
-		NNHebbianRuleStep(&nn, 0, (NNFloat)alphanum / alphaden);
+	int16_t const alphanum = vm->variables[AsebaNativePopArg(vm)];
+	int16_t const alphaden = vm->variables[AsebaNativePopArg(vm)];
+
+	if (current->nn.layerCount == 1 && current->nn.layer[0].activation == NNActivationIdentity
+		&& current->nn.layer[0].W) {
+		fixedFree();
+		NNHebbianRuleStep(&current->nn, 0, (NNFloat)alphanum / alphaden);
 	} else {
 		error = NNErrorUnsuitableForHebbianRule;
 	}
 }
 
 void NN_nnbackprop(AsebaVMState *vm) {
-	if (nn.layerCount == 0) {
+	int16_t const etanum = vm->variables[AsebaNativePopArg(vm)];
+	int16_t const etaden = vm->variables[AsebaNativePopArg(vm)];
+
+	if (current->nn.layerCount == 0) {
 		error = NNErrorNoNN;
-	} else if (!NNBackPropAllocStorage(&nn, &backpropTempMem)) {
+	} else if (NNHasSparseLayer(&current->nn)) {
+		error = NNErrorSparseLayer;
+	} else if (!backPropPrepare()) {
 		error = NNErrorOutOfMemory;
 	} else {
-		int16_t const etanum = vm->variables[AsebaNativePopArg(vm)];
-		int16_t const etaden = vm->variables[AsebaNativePopArg(vm)];
-		if (NNBackPropInit(&nn, &bp, backpropTempMem)) {
-			NNBackPropAddGradients(&nn, &bp);
-			NNBackPropApply(&nn, &bp, (NNFloat)etanum / etaden);
-		}
+		fixedFree();
+		NNBackPropResetGradients(&current->nn, &current->bp);
+		NNBackPropAddGradients(&current->nn, &current->bp);
+		NNBackPropApply(&current->nn, &current->bp, (NNFloat)etanum / etaden);
 	}
 }
 
 void NN_nndatasetinit(AsebaVMState *vm) {
 	uint16_t const observationMaxCount = vm->variables[AsebaNativePopArg(vm)];
-	NNObservationsInit(&obs, nn.inputCount, nn.outputCount, observationMaxCount);
+	if (networkMemorySize(&current->nn) + datasetMemorySize(current->nn.inputCount,
+		current->nn.outputCount, observationMaxCount) > NNHandleMemoryMax) {
+		error = NNErrorOutOfMemory;
+		return;
+	}
+	NNObservationsInit(&current->obs, current->nn.inputCount, current->nn.outputCount, observationMaxCount);
 }
 
 void NN_nndatasetadd(AsebaVMState *vm) {
@@ -375,53 +669,269 @@ void NN_nndatasetadd(AsebaVMState *vm) {
 	uint16_t const inputLength = AsebaNativePopArg(vm);
 	uint16_t const outputLength = AsebaNativePopArg(vm);
 
-	if (nn.layerCount == 0) {
+	if (current->nn.layerCount == 0) {
 		error = NNErrorNoNN;
-	} else if (obs.count >= obs.maxCount) {
+	} else if (current->obs.maxCount == 0
+		|| (current->obs.count >= current->obs.maxCount && !current->obs.ring)) {
 		error = NNErrorDatasetSizeExceeded;
 	} else {
+		// values written directly in the observation, missing values set to 0
 		NNFloat *dataSetInput, *dataSetOutput;
-		NNObservationGetPtr(&obs, obs.count, &dataSetInput, &dataSetOutput);
-		for (int i = 0; i < inputLength && i < nn.inputCount; i++) {
-			dataSetInput[i] = (NNFloat)input[i];
+		NNObservationGetPtr(&current->obs,
+			NNObservationsAdd(&current->obs, NULL, NULL),
+			&dataSetInput, &dataSetOutput);
+		for (int i = 0; i < current->obs.inputCount; i++) {
+			dataSetInput[i] = i < inputLength ? (NNFloat)input[i] : 0;
 		}
-		for (int i = 0; i < outputLength && i < nn.outputCount; i++) {
-			dataSetOutput[i] = (NNFloat)output[i];
+		for (int i = 0; i < current->obs.outputCount; i++) {
+			dataSetOutput[i] = i < outputLength ? (NNFloat)output[i] : 0;
 		}
-		obs.count++;
 	}
 }
 
 void NN_nnbackpropdataset(AsebaVMState *vm) {
-	if (nn.layerCount == 0) {
+	int16_t const etanum = vm->variables[AsebaNativePopArg(vm)];
+	int16_t const etaden = vm->variables[AsebaNativePopArg(vm)];
+	int16_t const numIter = vm->variables[AsebaNativePopArg(vm)];
+
+	if (current->nn.layerCount == 0) {
 		error = NNErrorNoNN;
-	} else if (!NNBackPropAllocStorage(&nn, &backpropTempMem)) {
+	} else if (NNHasSparseLayer(&current->nn)) {
+		error = NNErrorSparseLayer;
+	} else if (!backPropPrepare()) {
 		error = NNErrorOutOfMemory;
 	} else {
-		int16_t const etanum = vm->variables[AsebaNativePopArg(vm)];
-		int16_t const etaden = vm->variables[AsebaNativePopArg(vm)];
 		NNFloat eta = (NNFloat)etanum / etaden;
-		int16_t const numIter = vm->variables[AsebaNativePopArg(vm)];
-		if (NNBackPropInit(&nn, &bp, backpropTempMem)) {
-			for (int i = 0; i < numIter; i++) {
-				for (int j = 0; j < obs.count; j++) {
-					NNFloat *input, *output;
-					NNObservationGetPtr(&obs, j, &input, &output);
-
-					NNFloat *nnInput = NNGetInputPtr(&nn);
-					NNFloat *nnOutput = NNGetOutputPtr(&nn);
-					for (int k = 0; k < nn.inputCount; k++) {
-						nnInput[k] = input[k];
-					}
-					for (int k = 0; k < nn.outputCount; k++) {
-						nnOutput[k] = output[k];
-					}
-
-					NNBackPropResetGradients(&nn, &bp);
-					NNBackPropAddGradients(&nn, &bp);
-					NNBackPropApply(&nn, &bp, eta);
-				}
+		fixedFree();
+		for (int i = 0; i < numIter; i++) {
+			for (int j = 0; j < current->obs.count; j++) {
+				NNBackPropBatch(&current->nn, &current->bp, &current->obs, j, 1, eta);
 			}
 		}
 	}
 }
+
+// nn.backprop.batch(etanum, etaden, numIter, batchSize)
+void NN_nnbackpropbatch(AsebaVMState *vm) {
+	int16_t const etanum = vm->variables[AsebaNativePopArg(vm)];
+	int16_t const etaden = vm->variables[AsebaNativePopArg(vm)];
+	int16_t const numIter = vm->variables[AsebaNativePopArg(vm)];
+	int16_t const batchSize = vm->variables[AsebaNativePopArg(vm)];
+
+	if (current->nn.layerCount == 0) {
+		error = NNErrorNoNN;
+	} else if (NNHasSparseLayer(&current->nn)) {
+		error = NNErrorSparseLayer;
+	} else if (batchSize < 1) {
+		error = NNErrorIndexOutOfRange;
+	} else if (!backPropPrepare()) {
+		error = NNErrorOutOfMemory;
+	} else {
+		NNFloat eta = (NNFloat)etanum / etaden;
+		fixedFree();
+		for (int i = 0; i < numIter; i++) {
+			// last batch of each iteration can be smaller
+			for (int j = 0; j < current->obs.count; j += batchSize) {
+				NNBackPropBatch(&current->nn, &current->bp, &current->obs, j,
+					j + batchSize <= current->obs.count ? batchSize : current->obs.count - j, eta);
+			}
+		}
+	}
+}
+
+// nn.getweights.scaled(layerIndex, w, exponent)
+void NN_nngetweightsscaled(AsebaVMState *vm) {
+	const int16_t layerIndex = vm->variables[AsebaNativePopArg(vm)];
+	int16_t *w = &vm->variables[AsebaNativePopArg(vm)];
+	int16_t *exponent = &vm->variables[AsebaNativePopArg(vm)];
+	uint16_t const length = AsebaNativePopArg(vm);
+
+	if (current->nn.layerCount == 0) {
+		error = NNErrorNoNN;
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount
+		&& !current->nn.layer[layerIndex].W) {
+		error = NNErrorSparseLayer;
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount) {
+		NNLayer *layer = &current->nn.layer[layerIndex];
+		int n = layer->inputCount * layer->outputCount;
+		*exponent = scaledExponent(layer->W, n);
+		toScaled(w, layer->W, length < n ? length : n, *exponent);
+	} else {
+		error = NNErrorIndexOutOfRange;
+	}
+}
+
+// nn.setweights.scaled(layerIndex, w, exponent)
+void NN_nnsetweightsscaled(AsebaVMState *vm) {
+	const int16_t layerIndex = vm->variables[AsebaNativePopArg(vm)];
+	int16_t *w = &vm->variables[AsebaNativePopArg(vm)];
+	const int16_t exponent = vm->variables[AsebaNativePopArg(vm)];
+	uint16_t const length = AsebaNativePopArg(vm);
+
+	if (current->nn.layerCount == 0) {
+		error = NNErrorNoNN;
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount
+		&& !current->nn.layer[layerIndex].W) {
+		error = NNErrorSparseLayer;
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount) {
+		NNLayer *layer = &current->nn.layer[layerIndex];
+		fixedFree();
+		int n = layer->inputCount * layer->outputCount;
+		fromScaled(layer->W, w, length < n ? length : n, exponent);
+	} else {
+		error = NNErrorIndexOutOfRange;
+	}
+}
+
+// nn.getoffsets.scaled(layerIndex, b, exponent)
+void NN_nngetoffsetsscaled(AsebaVMState *vm) {
+	const int16_t layerIndex = vm->variables[AsebaNativePopArg(vm)];
+	int16_t *b = &vm->variables[AsebaNativePopArg(vm)];
+	int16_t *exponent = &vm->variables[AsebaNativePopArg(vm)];
+	uint16_t const length = AsebaNativePopArg(vm);
+
+	if (current->nn.layerCount == 0) {
+		error = NNErrorNoNN;
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount) {
+		NNLayer *layer = &current->nn.layer[layerIndex];
+		int n = layer->outputCount;
+		*exponent = scaledExponent(layer->B, n);
+		toScaled(b, layer->B, length < n ? length : n, *exponent);
+	} else {
+		error = NNErrorIndexOutOfRange;
+	}
+}
+
+// nn.setoffsets.scaled(layerIndex, b, exponent)
+void NN_nnsetoffsetsscaled(AsebaVMState *vm) {
+	const int16_t layerIndex = vm->variables[AsebaNativePopArg(vm)];
+	int16_t *b = &vm->variables[AsebaNativePopArg(vm)];
+	const int16_t exponent = vm->variables[AsebaNativePopArg(vm)];
+	uint16_t const length = AsebaNativePopArg(vm);
+
+	if (current->nn.layerCount == 0) {
+		error = NNErrorNoNN;
+	} else if (layerIndex >= 0 && layerIndex < current->nn.layerCount) {
+		NNLayer *layer = &current->nn.layer[layerIndex];
+		fixedFree();
+		int n = layer->outputCount;
+		fromScaled(layer->B, b, length < n ? length : n, exponent);
+	} else {
+		error = NNErrorIndexOutOfRange;
+	}
+}
+
+// nn.setinputs.scaled(inputs, exponent)
+void NN_nnsetinputsscaled(AsebaVMState *vm) {
+	int16_t *inputs = &vm->variables[AsebaNativePopArg(vm)];
+	const int16_t exponent = vm->variables[AsebaNativePopArg(vm)];
+	uint16_t const length = AsebaNativePopArg(vm);
+
+	if (current->nn.layerCount > 0) {
+		NNLayer *layer0 = &current->nn.layer[0];
+		fromScaled(layer0->input, inputs,
+			length < layer0->inputCount ? length : layer0->inputCount, exponent);
+	} else {
+		error = NNErrorNoNN;
+	}
+}
+
+// nn.getoutputs.scaled(outputs, exponent)
+void NN_nngetoutputsscaled(AsebaVMState *vm) {
+	int16_t *outputs = &vm->variables[AsebaNativePopArg(vm)];
+	const int16_t exponent = vm->variables[AsebaNativePopArg(vm)];
+	uint16_t const length = AsebaNativePopArg(vm);
+
+	if (current->nn.layerCount > 0) {
+		NNLayer *layerLast = &current->nn.layer[current->nn.layerCount - 1];
+		toScaled(outputs, layerLast->output,
+			length < layerLast->outputCount ? length : layerLast->outputCount,
+			exponent);
+	} else {
+		error = NNErrorNoNN;
+	}
+}
+
+// nn.setoutputs.scaled(outputs, exponent)
+void NN_nnsetoutputsscaled(AsebaVMState *vm) {
+	int16_t *outputs = &vm->variables[AsebaNativePopArg(vm)];
+	const int16_t exponent = vm->variables[AsebaNativePopArg(vm)];
+	uint16_t const length = AsebaNativePopArg(vm);
+
+	if (current->nn.layerCount > 0) {
+		NNLayer *layerLast = &current->nn.layer[current->nn.layerCount - 1];
+		fromScaled(layerLast->output, outputs,
+			length < layerLast->outputCount ? length : layerLast->outputCount,
+			exponent);
+	} else {
+		error = NNErrorNoNN;
+	}
+}
+
+// nn.train.start(etanum, etaden, numIter, batchSize)
+void NN_nntrainstart(AsebaVMState *vm) {
+	int16_t const etanum = vm->variables[AsebaNativePopArg(vm)];
+	int16_t const etaden = vm->variables[AsebaNativePopArg(vm)];
+	int16_t const numIter = vm->variables[AsebaNativePopArg(vm)];
+	int16_t const batchSize = vm->variables[AsebaNativePopArg(vm)];
+
+	if (current->nn.layerCount == 0) {
+		error = NNErrorNoNN;
+	} else if (NNHasSparseLayer(&current->nn)) {
+		error = NNErrorSparseLayer;
+	} else if (batchSize < 1 || etaden == 0) {
+		error = NNErrorIndexOutOfRange;
+	} else {
+		NNTrainingStart(&current->training, &current->obs, numIter, batchSize,
+			(NNFloat)etanum / etaden, current->sampling);
+	}
+}
+
+// nn.train.step(maxSteps, progress, costnum, costden)
+void NN_nntrainstep(AsebaVMState *vm) {
+	int16_t const maxSteps = vm->variables[AsebaNativePopArg(vm)];
+	int16_t *progress = &vm->variables[AsebaNativePopArg(vm)];
+	int16_t *costnum = &vm->variables[AsebaNativePopArg(vm)];
+	int16_t *costden = &vm->variables[AsebaNativePopArg(vm)];
+	NNTraining *training = &current->training;
+
+	if (current->nn.layerCount == 0) {
+		error = NNErrorNoNN;
+	} else if (NNHasSparseLayer(&current->nn)) {
+		error = NNErrorSparseLayer;
+	} else if (training->obs == NULL) {
+		error = NNErrorNoTraining;
+	} else if (!backPropPrepare()) {
+		error = NNErrorOutOfMemory;
+	} else {
+		fixedFree();
+		NNTrainingStep(&current->nn, &current->bp, training, maxSteps);
+		// percentage of observations processed
+		*progress = training->count > 0
+			? (int16_t)((100L * training->done) / training->count)
+			: 100;
+		fractionApprox(training->cost, costnum, costden);
+	}
+}
+
+// nn.dataset.ring(enable)
+void NN_nndatasetring(AsebaVMState *vm) {
+	int16_t const enable = vm->variables[AsebaNativePopArg(vm)];
+	current->obs.ring = enable != 0;
+}
+
+// nn.train.sampling(sampling)
+void NN_nntrainsampling(AsebaVMState *vm) {
+	int16_t const sampling = vm->variables[AsebaNativePopArg(vm)];
+	current->sampling = sampling == 1 ? NNSamplingUniform
+		: sampling == 2 ? NNSamplingPriority
+		: sampling == 3 ? NNSamplingShuffle
+		: NNSamplingSweep;
+	current->training.sampling = current->sampling;
+}
+
+// nn.seed(seed)
+void NN_nnseed(AsebaVMState *vm) {
+	int16_t const seed = vm->variables[AsebaNativePopArg(vm)];
+	NNSeed(&current->nn, (uint16_t)seed);
+}
@@ -33,12 +33,24 @@ extern AsebaNativeFunctionDescription NNNativeDescription_nninit;
 void NN_nnfree(AsebaVMState *vm);
 extern AsebaNativeFunctionDescription NNNativeDescription_nnfree;
 
+void NN_nnsetaccuracy(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nnsetaccuracy;
+
+void NN_nnsetoptimizer(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nnsetoptimizer;
+
 void NN_nnreset(AsebaVMState *vm);
 extern AsebaNativeFunctionDescription NNNativeDescription_nnreset;
 
 void NN_nnclear(AsebaVMState *vm);
 extern AsebaNativeFunctionDescription NNNativeDescription_nnclear;
 
+void NN_nnprune(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nnprune;
+
+void NN_nnselect(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nnselect;
+
 void NN_nngetweight(AsebaVMState *vm);
 extern AsebaNativeFunctionDescription NNNativeDescription_nngetweight;
 
@@ -63,6 +75,18 @@ extern AsebaNativeFunctionDescription NNNativeDescription_nngetoffsets;
 void NN_nnsetoffsets(AsebaVMState *vm);
 extern AsebaNativeFunctionDescription NNNativeDescription_nnsetoffsets;
 
+void NN_nngetweightsscaled(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nngetweightsscaled;
+
+void NN_nnsetweightsscaled(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nnsetweightsscaled;
+
+void NN_nngetoffsetsscaled(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nngetoffsetsscaled;
+
+void NN_nnsetoffsetsscaled(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nnsetoffsetsscaled;
+
 void NN_nngetinputs(AsebaVMState *vm);
 extern AsebaNativeFunctionDescription NNNativeDescription_nngetinputs;
 
@@ -75,9 +99,24 @@ extern AsebaNativeFunctionDescription NNNativeDescription_nngetoutputs;
 void NN_nnsetoutputs(AsebaVMState *vm);
 extern AsebaNativeFunctionDescription NNNativeDescription_nnsetoutputs;
 
+void NN_nnsetinputsscaled(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nnsetinputsscaled;
+
+void NN_nngetoutputsscaled(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nngetoutputsscaled;
+
+void NN_nnsetoutputsscaled(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nnsetoutputsscaled;
+
 void NN_nneval(AsebaVMState *vm);
 extern AsebaNativeFunctionDescription NNNativeDescription_nneval;
 
+void NN_nnfixedinit(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nnfixedinit;
+
+void NN_nnfixedeval(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nnfixedeval;
+
 void NN_nnhebbianrule(AsebaVMState *vm);
 extern AsebaNativeFunctionDescription NNNativeDescription_nnhebbianrule;
 
@@ -93,6 +132,24 @@ extern AsebaNativeFunctionDescription NNNativeDescription_nndatasetadd;
 void NN_nnbackpropdataset(AsebaVMState *vm);
 extern AsebaNativeFunctionDescription NNNativeDescription_nnbackpropdataset;
 
+void NN_nnbackpropbatch(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nnbackpropbatch;
+
+void NN_nntrainstart(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nntrainstart;
+
+void NN_nntrainstep(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nntrainstep;
+
+void NN_nndatasetring(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nndatasetring;
+
+void NN_nntrainsampling(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nntrainsampling;
+
+void NN_nnseed(AsebaVMState *vm);
+extern AsebaNativeFunctionDescription NNNativeDescription_nnseed;
+
 // defines listing all native functions and their descriptions
 
 #define NN_NATIVES_DESCRIPTIONS \
@@ -119,7 +176,26 @@ extern AsebaNativeFunctionDescription NNNativeDescription_nnbackpropdataset;
 	&NNNativeDescription_nnbackprop, \
 	&NNNativeDescription_nndatasetinit, \
 	&NNNativeDescription_nndatasetadd, \
-	&NNNativeDescription_nnbackpropdataset
+	&NNNativeDescription_nnbackpropdataset, \
+	&NNNativeDescription_nnfixedinit, \
+	&NNNativeDescription_nnfixedeval, \
+	&NNNativeDescription_nnsetaccuracy, \
+	&NNNativeDescription_nnbackpropbatch, \
+	&NNNativeDescription_nnsetoptimizer, \
+	&NNNativeDescription_nnprune, \
+	&NNNativeDescription_nnselect, \
+	&NNNativeDescription_nngetweightsscaled, \
+	&NNNativeDescription_nnsetweightsscaled, \
+	&NNNativeDescription_nngetoffsetsscaled, \
+	&NNNativeDescription_nnsetoffsetsscaled, \
+	&NNNativeDescription_nnsetinputsscaled, \
+	&NNNativeDescription_nngetoutputsscaled, \
+	&NNNativeDescription_nnsetoutputsscaled, \
+	&NNNativeDescription_nntrainstart, \
+	&NNNativeDescription_nntrainstep, \
+	&NNNativeDescription_nndatasetring, \
+	&NNNativeDescription_nntrainsampling, \
+	&NNNativeDescription_nnseed
 
 #define NN_NATIVES_FUNCTIONS \
 	NN_nngeterror, \
@@ -145,7 +221,26 @@ extern AsebaNativeFunctionDescription NNNativeDescription_nnbackpropdataset;
 	NN_nnbackprop, \
 	NN_nndatasetinit, \
 	NN_nndatasetadd, \
-	NN_nnbackpropdataset
+	NN_nnbackpropdataset, \
+	NN_nnfixedinit, \
+	NN_nnfixedeval, \
+	NN_nnsetaccuracy, \
+	NN_nnbackpropbatch, \
+	NN_nnsetoptimizer, \
+	NN_nnprune, \
+	NN_nnselect, \
+	NN_nngetweightsscaled, \
+	NN_nnsetweightsscaled, \
+	NN_nngetoffsetsscaled, \
+	NN_nnsetoffsetsscaled, \
+	NN_nnsetinputsscaled, \
+	NN_nngetoutputsscaled, \
+	NN_nnsetoutputsscaled, \
+	NN_nntrainstart, \
+	NN_nntrainstep, \
+	NN_nndatasetring, \
+	NN_nntrainsampling, \
+	NN_nnseed
 
 #if defined(__cplusplus)
 }